@@ -59,6 +59,8 @@
 #include "../../../../src/p2p/network_throttle-detail.hpp"
 
 #define ABSTRACT_SERVER_SEND_QUE_MAX_COUNT 1000
+#define ABSTRACT_SERVER_READ_BUFFER_MIN_SIZE 8192
+#define ABSTRACT_SERVER_READ_BUFFER_MAX_SIZE (256 * 1024)
 
 namespace epee
 {
@@ -116,7 +118,8 @@ namespace net_utils
   private:
     //----------------- i_service_endpoint ---------------------
     virtual bool do_send(const void* ptr, size_t cb); ///< (see do_send from i_service_endpoint)
-    virtual bool do_send_chunk(const void* ptr, size_t cb); ///< will send (or queue) a part of data
+    virtual bool do_send(const shared_buffer& message); ///< queues message itself, without copying it
+    virtual bool do_send_chunk(const shared_buffer& chunk); ///< will send (or queue) a part of data
     virtual bool close();
     virtual bool call_run_once_service_io();
     virtual bool request_callback();
@@ -133,9 +136,8 @@ namespace net_utils
     /// Handle completion of a write operation.
     void handle_write(const boost::system::error_code& e, size_t cb);
 
-    /// Buffer for incoming data.
-    boost::array<char, 8192> buffer_;
-    //boost::array<char, 1024> buffer_;
+    /// Buffer for incoming data, grows while reads keep filling it up.
+    std::vector<char> buffer_;
 
     t_connection_context context;
     i_connection_filter* &m_pfilter;
@@ -197,6 +199,17 @@ namespace net_utils
 
     void set_threads_prefix(const std::string& prefix_name);
 
+    /// Spread connections over this many extra io_services, each run by its own thread, instead
+    /// of running them all on the shared one (0, the default). Call before init_server.
+    void set_io_service_shards(size_t shards);
+
+    struct io_shard_stats
+    {
+      long connections;          ///< connections currently on the shard
+      uint64_t total_connections; ///< connections ever assigned to the shard
+    };
+    std::vector<io_shard_stats> get_io_shard_stats() const;
+
     bool deinit_server(){return true;}
 
     size_t get_threads_count(){return m_threads_count;}
@@ -277,14 +290,37 @@ namespace net_utils
     /// Handle completion of an asynchronous accept operation.
     void handle_accept(const boost::system::error_code& e);
 
+    /// Run the io_service loop of one shard.
+    bool shard_worker_thread(size_t index);
+
     bool is_thread_worker();
 
     bool cleanup_connections();
 
+    /// Creates a connection on the next shard, or on io_service_ if there are none.
+    connection_ptr make_connection();
+
+    long get_connections_count() const;
+
+    bool is_multithreaded() const { return 1 < m_threads_count || !m_shards.empty(); }
+
     /// The io_service used to perform asynchronous operations.
     std::unique_ptr<boost::asio::io_service> m_io_service_local_instance;
     boost::asio::io_service& io_service_;    
 
+    /// An io_service with its own thread, and the connections pinned to it.
+    struct io_shard
+    {
+      std::atomic<long> sock_count;
+      std::atomic<uint64_t> total_connections;
+      boost::asio::io_service io_service;
+      boost::asio::io_service::work work; ///< keeps the shard's thread running while it has no connections
+
+      io_shard(): sock_count(0), total_connections(0), work(io_service) {}
+    };
+    std::vector<std::unique_ptr<io_shard> > m_shards;
+    std::atomic<size_t> m_next_shard;
+
     /// Acceptor used to listen for incoming connections.
     boost::asio::ip::tcp::acceptor acceptor_;
 
@@ -84,6 +84,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
 	)
 	: 
 		connection_basic(io_service, ref_sock_count, sock_number), 
+		buffer_(ABSTRACT_SERVER_READ_BUFFER_MIN_SIZE),
 		m_protocol_handler(this, config, context),
 		m_pfilter( pfilter ),
 		m_connection_type( connection_type ),
@@ -323,6 +324,10 @@ PRAGMA_WARNING_DISABLE_VS(4355)
       context.m_last_recv = time(NULL);
       context.m_recv_cnt += bytes_transferred;
       bool recv_res = m_protocol_handler.handle_recv(buffer_.data(), bytes_transferred);
+      // a full buffer means more is waiting, so read bigger chunks (such as
+      // block downloads) in fewer calls
+      if(bytes_transferred == buffer_.size() && buffer_.size() < ABSTRACT_SERVER_READ_BUFFER_MAX_SIZE)
+        buffer_.resize(buffer_.size() * 2);
       if(!recv_res)
       {  
         //_info("[sock " << socket_.native_handle() << "] protocol_want_close");
@@ -389,13 +394,21 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   //---------------------------------------------------------------------------------
     template<class t_protocol_handler>
   bool connection<t_protocol_handler>::do_send(const void* ptr, size_t cb) {
+    // the send queue needs its own copy of the data
+    return do_send(shared_buffer(std::string(static_cast<const char*>(ptr), cb)));
+  }
+  //---------------------------------------------------------------------------------
+    template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::do_send(const shared_buffer& buffer) {
     TRY_ENTRY();
 
     // Use safe_shared_from_this, because of this is public method and it can be called on the object being deleted
     auto self = safe_shared_from_this();
     if (!self) return false;
     if (m_was_shutdown) return false;
-		// TODO avoid copy
+    shared_buffer message(buffer);
+    const size_t cb = message.size();
+    const void* ptr = message.data();
 
 		const double factor = 32; // TODO config
 		typedef long long signed int t_safe; // my t_size to avoid any overunderflow in arithmetic
@@ -433,14 +446,10 @@ PRAGMA_WARNING_DISABLE_VS(4355)
                     ASRT(len>0); // (redundand)
                     ASRT(len_unsigned < std::numeric_limits<size_t>::max());   // yeap we want strong < then max size, to be sure
 					
-					void *chunk_start = ((char*)ptr) + pos;
-					_fact_c("net/out/size","chunk_start="<<chunk_start<<" ptr="<<ptr<<" pos="<<pos);
-					ASRT(chunk_start >= ptr); // not wrapped around address?
-					//std::memcpy( (void*)buf, chunk_start, len);
-
 					_dbg3_c("net/out/size", "part of " << lenall << ": pos="<<pos << " len="<<len);
 
-					bool ok = do_send_chunk(chunk_start, len); // <====== ***
+					// chunks share the message's buffer
+					bool ok = do_send_chunk(message.take_slice(len)); // <====== ***
 
 					all_ok = all_ok && ok;
 					if (!all_ok) {
@@ -463,7 +472,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
 			} // LOCK: chunking
 		} // a big block (to be chunked) - all chunks
 		else { // small block
-			return do_send_chunk(ptr,cb); // just send as 1 big chunk
+			return do_send_chunk(message); // just send as 1 big chunk
 		}
 
     CATCH_ENTRY_L0("connection<t_protocol_handler>::do_send", false);
@@ -471,9 +480,10 @@ PRAGMA_WARNING_DISABLE_VS(4355)
 
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
-  bool connection<t_protocol_handler>::do_send_chunk(const void* ptr, size_t cb)
+  bool connection<t_protocol_handler>::do_send_chunk(const shared_buffer& chunk)
   {
     TRY_ENTRY();
+    const size_t cb = chunk.size();
     // Use safe_shared_from_this, because of this is public method and it can be called on the object being deleted
     auto self = safe_shared_from_this();
     if(!self)
@@ -525,8 +535,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
         }
     }
 
-    m_send_que.resize(m_send_que.size()+1);
-    m_send_que.back().assign((const char*)ptr, cb);
+    m_send_que.push_back(chunk);
     
     if(m_send_que.size() > 1)
     { // active operation should be in progress, nothing to do, just wait last operation callback
@@ -548,7 +557,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
         auto size_now = m_send_que.front().size();
         _dbg1_c("net/out/size", "do_send() NOW SENSD: packet="<<size_now<<" B");
         if (speed_limit_is_enabled())
-			do_send_handler_write( ptr , size_now ); // (((H)))
+			do_send_handler_write( m_send_que.front().data() , size_now ); // (((H)))
 
         ASRT( size_now == m_send_que.front().size() );
         boost::asio::async_write(socket_, boost::asio::buffer(m_send_que.front().data(), size_now ) ,
@@ -684,6 +693,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   boosted_tcp_server<t_protocol_handler>::boosted_tcp_server( t_connection_type connection_type ) :
     m_io_service_local_instance(new boost::asio::io_service()),
     io_service_(*m_io_service_local_instance.get()),
+    m_next_shard(0),
     acceptor_(io_service_),
     m_stop_signal_sent(false), m_port(0), 
 	m_sock_count(0), m_sock_number(0), m_threads_count(0), 
@@ -698,6 +708,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   template<class t_protocol_handler>
   boosted_tcp_server<t_protocol_handler>::boosted_tcp_server(boost::asio::io_service& extarnal_io_service, t_connection_type connection_type) :
     io_service_(extarnal_io_service),
+    m_next_shard(0),
     acceptor_(io_service_),
     m_stop_signal_sent(false), m_port(0), 
 		m_sock_count(0), m_sock_number(0), m_threads_count(0), 
@@ -795,6 +806,70 @@ POP_WARNINGS
   }
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
+  bool boosted_tcp_server<t_protocol_handler>::shard_worker_thread(size_t index)
+  {
+    TRY_ENTRY();
+    std::string thread_name = std::string("[") + m_thread_name_prefix + "_SHARD";
+    thread_name += boost::to_string(index) + "]";
+    log_space::log_singletone::set_thread_log_prefix(thread_name);
+    while(!m_stop_signal_sent)
+    {
+      try
+      {
+        m_shards[index]->io_service.run();
+      }
+      catch(const std::exception& ex)
+      {
+        _erro("Exception at server shard thread, what=" << ex.what());
+      }
+      catch(...)
+      {
+        _erro("Exception at server shard thread, unknown execption");
+      }
+    }
+    return true;
+    CATCH_ENTRY_L0("boosted_tcp_server<t_protocol_handler>::shard_worker_thread", false);
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  void boosted_tcp_server<t_protocol_handler>::set_io_service_shards(size_t shards)
+  {
+    m_shards.clear();
+    for (size_t i = 0; i < shards; ++i)
+      m_shards.emplace_back(new io_shard());
+    // the connection waiting to be accepted was made on io_service_
+    new_connection_ = make_connection();
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  std::vector<typename boosted_tcp_server<t_protocol_handler>::io_shard_stats> boosted_tcp_server<t_protocol_handler>::get_io_shard_stats() const
+  {
+    std::vector<io_shard_stats> stats;
+    for (const auto &shard: m_shards)
+      stats.push_back({shard->sock_count.load(), shard->total_connections.load()});
+    return stats;
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  typename boosted_tcp_server<t_protocol_handler>::connection_ptr boosted_tcp_server<t_protocol_handler>::make_connection()
+  {
+    if (m_shards.empty())
+      return connection_ptr(new connection<t_protocol_handler>(io_service_, m_config, m_sock_count, m_sock_number, m_pfilter, m_connection_type));
+    io_shard &shard = *m_shards[m_next_shard++ % m_shards.size()];
+    ++shard.total_connections;
+    return connection_ptr(new connection<t_protocol_handler>(shard.io_service, m_config, shard.sock_count, m_sock_number, m_pfilter, m_connection_type));
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  long boosted_tcp_server<t_protocol_handler>::get_connections_count() const
+  {
+    long count = m_sock_count;
+    for (const auto &shard: m_shards)
+      count += shard->sock_count;
+    return count;
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
   void boosted_tcp_server<t_protocol_handler>::set_threads_prefix(const std::string& prefix_name)
   {
     m_thread_name_prefix = prefix_name;
@@ -831,6 +906,13 @@ POP_WARNINGS
           _note("Run server thread name: " << m_thread_name_prefix);
         m_threads.push_back(thread);
       }
+      // and one thread per shard, each running only its own io_service
+      for (std::size_t i = 0; i < m_shards.size(); ++i)
+      {
+        boost::shared_ptr<boost::thread> thread(new boost::thread(
+          attrs, boost::bind(&boosted_tcp_server<t_protocol_handler>::shard_worker_thread, this, i)));
+        m_threads.push_back(thread);
+      }
       CRITICAL_REGION_END();
       // Wait for all threads in the pool to exit.
       if (wait)
@@ -913,6 +995,8 @@ POP_WARNINGS
     connections_.clear();
     connections_mutex.unlock();
     io_service_.stop();
+    for (auto &shard: m_shards)
+      shard->io_service.stop();
     CATCH_ENTRY_L0("boosted_tcp_server<t_protocol_handler>::send_stop_signal()", void());
   }
   //---------------------------------------------------------------------------------
@@ -948,16 +1032,16 @@ POP_WARNINGS
 			new_connection_->setRpcStation(); // hopefully this is not needed actually
 		}
 		connection_ptr conn(std::move(new_connection_));
-      new_connection_.reset(new connection<t_protocol_handler>(io_service_, m_config, m_sock_count, m_sock_number, m_pfilter, m_connection_type));
+      new_connection_ = make_connection();
       acceptor_.async_accept(new_connection_->socket(),
         boost::bind(&boosted_tcp_server<t_protocol_handler>::handle_accept, this,
         boost::asio::placeholders::error));
 
-      conn->start(true, 1 < m_threads_count);
+      conn->start(true, is_multithreaded());
       conn->save_dbg_log();
     }else
     {
-      _erro("Some problems at accept: " << e.message() << ", connections_count = " << m_sock_count);
+      _erro("Some problems at accept: " << e.message() << ", connections_count = " << get_connections_count());
     }
     CATCH_ENTRY_L0("boosted_tcp_server<t_protocol_handler>::handle_accept", void());
   }
@@ -967,7 +1051,7 @@ POP_WARNINGS
   {
     TRY_ENTRY();
 
-    connection_ptr new_connection_l(new connection<t_protocol_handler>(io_service_, m_config, m_sock_count, m_sock_number, m_pfilter, m_connection_type) );
+    connection_ptr new_connection_l = make_connection();
     connections_mutex.lock();
     connections_.push_back(std::make_pair(boost::get_system_time(), new_connection_l));
     LOG_PRINT_L2("connections_ size now " << connections_.size());
@@ -1049,7 +1133,7 @@ POP_WARNINGS
 
     _dbg3("Connected success to " << adr << ':' << port);
 
-    bool r = new_connection_l->start(false, 1 < m_threads_count);
+    bool r = new_connection_l->start(false, is_multithreaded());
     if (r)
     {
       new_connection_l->get_context(conn_context);
@@ -1057,7 +1141,7 @@ POP_WARNINGS
     }
     else
     {
-      _erro("[sock " << new_connection_->socket().native_handle() << "] Failed to start connection, connections_count = " << m_sock_count);
+      _erro("[sock " << new_connection_->socket().native_handle() << "] Failed to start connection, connections_count = " << get_connections_count());
     }
     
 	new_connection_l->save_dbg_log();
@@ -1071,7 +1155,7 @@ POP_WARNINGS
   bool boosted_tcp_server<t_protocol_handler>::connect_async(const std::string& adr, const std::string& port, uint32_t conn_timeout, t_callback cb, const std::string& bind_ip)
   {
     TRY_ENTRY();    
-    connection_ptr new_connection_l(new connection<t_protocol_handler>(io_service_, m_config, m_sock_count, m_sock_number, m_pfilter, m_connection_type) );
+    connection_ptr new_connection_l = make_connection();
     connections_mutex.lock();
     connections_.push_back(std::make_pair(boost::get_system_time(), new_connection_l));
     LOG_PRINT_L2("connections_ size now " << connections_.size());
@@ -1124,7 +1208,7 @@ POP_WARNINGS
           {
             _dbg3("[sock " << new_connection_l->socket().native_handle() << "] Connected success to " << adr << ':' << port <<
               " from " << lep.address().to_string() << ':' << lep.port());
-            bool r = new_connection_l->start(false, 1 < m_threads_count);
+            bool r = new_connection_l->start(false, is_multithreaded());
             if (r)
             {
               new_connection_l->get_context(conn_context);
@@ -74,6 +74,11 @@ namespace epee
       return true;
     }
 
+    void set_io_service_shards(size_t shards)
+    {
+      m_net_server.set_io_service_shards(shards);
+    }
+
     bool run(size_t threads_count, bool wait = true)
     {
       //go to loop
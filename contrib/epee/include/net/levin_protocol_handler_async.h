@@ -44,6 +44,25 @@ namespace epee
 namespace levin
 {
 
+/*! Builds a complete notification packet, so the same bytes can be sent to
+    any number of connections with async_protocol_handler_config::send. */
+inline net_utils::shared_buffer make_notify(int command, const std::string& in_buff)
+{
+  bucket_head2 head = {0};
+  head.m_signature = LEVIN_SIGNATURE;
+  head.m_have_to_return_data = false;
+  head.m_cb = in_buff.size();
+
+  head.m_command = command;
+  head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
+  head.m_flags = LEVIN_PACKET_REQUEST;
+  std::string packet;
+  packet.reserve(sizeof(head) + in_buff.size());
+  packet.append(reinterpret_cast<const char*>(&head), sizeof(head));
+  packet.append(in_buff);
+  return net_utils::shared_buffer(std::move(packet));
+}
+
 /************************************************************************/
 /*                                                                      */
 /************************************************************************/
@@ -76,6 +95,7 @@ public:
   int invoke_async(int command, const std::string& in_buff, boost::uuids::uuid connection_id, callback_t cb, size_t timeout = LEVIN_DEFAULT_TIMEOUT_PRECONFIGURED);
 
   int notify(int command, const std::string& in_buff, boost::uuids::uuid connection_id);
+  int send(const net_utils::shared_buffer& message, boost::uuids::uuid connection_id);
   bool close(boost::uuids::uuid connection_id);
   bool update_connection_context(const t_connection_context& contxt);
   bool request_callback(boost::uuids::uuid connection_id);
@@ -125,6 +145,7 @@ public:
   t_connection_context& m_connection_context;
 
   std::string m_cache_in_buffer;
+  size_t m_cache_in_offset; //bytes at the start of m_cache_in_buffer already consumed
   stream_state m_state;
 
   int32_t m_oponent_protocol_ver;
@@ -221,6 +242,7 @@ public:
             m_pservice_endpoint(psnd_hndlr), 
             m_config(config), 
             m_connection_context(conn_context), 
+            m_cache_in_offset(0),
             m_state(stream_state_head)
   {
     m_close_called = 0;
@@ -320,14 +342,21 @@ public:
       return false;
     }
 
-    if(m_cache_in_buffer.size() +  cb > m_config.m_max_packet_size)
+    if(m_cache_in_buffer.size() - m_cache_in_offset + cb > m_config.m_max_packet_size)
     {
       LOG_ERROR_CC(m_connection_context, "Maximum packet size exceed!, m_max_packet_size = " << m_config.m_max_packet_size 
-                          << ", packet received " << m_cache_in_buffer.size() +  cb 
+                          << ", packet received " << m_cache_in_buffer.size() - m_cache_in_offset + cb 
                           << ", connection will be closed.");
       return false;
     }
 
+    // packets are consumed by moving the offset, the consumed bytes are only
+    // dropped when the buffer would have to grow anyway
+    if(m_cache_in_offset && m_cache_in_buffer.size() + cb > m_cache_in_buffer.capacity())
+    {
+      m_cache_in_buffer.erase(0, m_cache_in_offset);
+      m_cache_in_offset = 0;
+    }
     m_cache_in_buffer.append((const char*)ptr, cb);
 
     bool is_continue = true;
@@ -336,19 +365,33 @@ public:
       switch(m_state)
       {
       case stream_state_body:
-        if(m_cache_in_buffer.size() < m_current_head.m_cb)
+        if(m_cache_in_buffer.size() - m_cache_in_offset < m_current_head.m_cb)
         {
           is_continue = false;
           break;
         }
         {
+          // a body which arrived over several reads starts the buffer, and is
+          // handed over without copying it; small ones are copied out
           std::string buff_to_invoke;
-          if(m_cache_in_buffer.size()  == m_current_head.m_cb)
+          if(m_cache_in_offset == 0 && m_cache_in_buffer.size() == m_current_head.m_cb)
             buff_to_invoke.swap(m_cache_in_buffer);
+          else if(m_cache_in_offset == 0 && m_cache_in_buffer.size() - m_current_head.m_cb < m_current_head.m_cb)
+          {
+            std::string rest(m_cache_in_buffer, (std::string::size_type)m_current_head.m_cb);
+            m_cache_in_buffer.resize((std::string::size_type)m_current_head.m_cb);
+            buff_to_invoke.swap(m_cache_in_buffer);
+            m_cache_in_buffer.swap(rest);
+          }
           else
           {
-            buff_to_invoke.assign(m_cache_in_buffer, 0, (std::string::size_type)m_current_head.m_cb);
-            m_cache_in_buffer.erase(0, (std::string::size_type)m_current_head.m_cb);
+            buff_to_invoke.assign(m_cache_in_buffer, m_cache_in_offset, (std::string::size_type)m_current_head.m_cb);
+            m_cache_in_offset += (size_t)m_current_head.m_cb;
+          }
+          if(m_cache_in_offset == m_cache_in_buffer.size())
+          {
+            m_cache_in_buffer.clear();
+            m_cache_in_offset = 0;
           }
 
           bool is_response = (m_oponent_protocol_ver == LEVIN_PROTOCOL_VER_1 && m_current_head.m_flags&LEVIN_PACKET_RESPONSE);
@@ -427,26 +470,38 @@ public:
         break;
       case stream_state_head:
         {
-          if(m_cache_in_buffer.size() < sizeof(bucket_head2))
+          const size_t available = m_cache_in_buffer.size() - m_cache_in_offset;
+          if(available < sizeof(bucket_head2))
           {
-            if(m_cache_in_buffer.size() >= sizeof(uint64_t) && *((uint64_t*)m_cache_in_buffer.data()) != LEVIN_SIGNATURE)
+            uint64_t signature;
+            if(available >= sizeof(uint64_t))
             {
-              LOG_ERROR_CC(m_connection_context, "Signature mismatch, connection will be closed");
-              return false;
+              memcpy(&signature, m_cache_in_buffer.data() + m_cache_in_offset, sizeof(signature));
+              if(signature != LEVIN_SIGNATURE)
+              {
+                LOG_ERROR_CC(m_connection_context, "Signature mismatch, connection will be closed");
+                return false;
+              }
             }
             is_continue = false;
             break;
           }
 
-          bucket_head2* phead = (bucket_head2*)m_cache_in_buffer.data();
-          if(LEVIN_SIGNATURE != phead->m_signature)
+          memcpy(&m_current_head, m_cache_in_buffer.data() + m_cache_in_offset, sizeof(bucket_head2));
+          if(LEVIN_SIGNATURE != m_current_head.m_signature)
           {
             LOG_ERROR_CC(m_connection_context, "Signature mismatch, connection will be closed");
             return false;
           }
-          m_current_head = *phead;
 
-          m_cache_in_buffer.erase(0, sizeof(bucket_head2));
+          m_cache_in_offset += sizeof(bucket_head2);
+          if(available - sizeof(bucket_head2) < m_current_head.m_cb)
+          {
+            // the body is still to come, start the buffer with what we have
+            // of it so it can be handed over as is once complete
+            m_cache_in_buffer.erase(0, m_cache_in_offset);
+            m_cache_in_offset = 0;
+          }
           m_state = stream_state_body;
           m_oponent_protocol_ver = m_current_head.m_protocol_version;
           if(m_current_head.m_cb > m_config.m_max_packet_size)
@@ -659,6 +714,32 @@ public:
     return 1;
   }
   //------------------------------------------------------------------------------------------
+  int send(const net_utils::shared_buffer& message)
+  {
+    misc_utils::auto_scope_leave_caller scope_exit_handler = misc_utils::create_scope_leave_handler(
+                          boost::bind(&async_protocol_handler::finish_outer_call, this));
+
+    if(m_deletion_initiated)
+      return LEVIN_ERROR_CONNECTION_DESTROYED;
+
+    CRITICAL_REGION_LOCAL(m_call_lock);
+
+    if(m_deletion_initiated)
+      return LEVIN_ERROR_CONNECTION_DESTROYED;
+
+    const size_t size = message.size();
+    CRITICAL_REGION_BEGIN(m_send_lock);
+    if(!m_pservice_endpoint->do_send(message))
+    {
+      LOG_ERROR_CC(m_connection_context, "Failed to do_send()");
+      return -1;
+    }
+    CRITICAL_REGION_END();
+    LOG_PRINT_CC_L4(m_connection_context, "LEVIN_PACKET_SENT. [size=" << size << "]");
+
+    return 1;
+  }
+  //------------------------------------------------------------------------------------------
   boost::uuids::uuid get_connection_id() {return m_connection_context.m_connection_id;}
   //------------------------------------------------------------------------------------------
   t_connection_context& get_context_ref() {return m_connection_context;}
@@ -775,6 +856,14 @@ int async_protocol_handler_config<t_connection_context>::notify(int command, con
 }
 //------------------------------------------------------------------------------------------
 template<class t_connection_context>
+int async_protocol_handler_config<t_connection_context>::send(const net_utils::shared_buffer& message, boost::uuids::uuid connection_id)
+{
+  async_protocol_handler<t_connection_context>* aph;
+  int r = find_and_lock_connection(connection_id, aph);
+  return LEVIN_OK == r ? aph->send(message) : r;
+}
+//------------------------------------------------------------------------------------------
+template<class t_connection_context>
 bool async_protocol_handler_config<t_connection_context>::close(boost::uuids::uuid connection_id)
 {
   CRITICAL_REGION_LOCAL(m_connects_lock);
@@ -29,7 +29,10 @@
 #ifndef _NET_UTILS_BASE_H_
 #define _NET_UTILS_BASE_H_
 
+#include <algorithm>
 #include <boost/uuid/uuid.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 #include "string_tools.h"
 
 #ifndef MAKE_IP
@@ -105,12 +108,47 @@ namespace net_utils
 
 	};
 
+	/************************************************************************/
+	/*                                                                      */
+	/************************************************************************/
+  /*! A slice of an immutable, reference counted buffer. Copies share the
+      bytes, so a message can be queued on many connections, or split into
+      chunks, without being copied. */
+  class shared_buffer
+  {
+  public:
+    shared_buffer(): m_offset(0), m_size(0) {}
+    explicit shared_buffer(std::string data):
+      m_data(boost::make_shared<const std::string>(std::move(data))), m_offset(0), m_size(m_data->size()) {}
+
+    const char* data() const { return m_data ? m_data->data() + m_offset : nullptr; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    //! removes up to max_bytes from the front, and returns them as a slice of the same buffer
+    shared_buffer take_slice(size_t max_bytes)
+    {
+      shared_buffer slice(*this);
+      slice.m_size = std::min(max_bytes, m_size);
+      m_offset += slice.m_size;
+      m_size -= slice.m_size;
+      return slice;
+    }
+
+  private:
+    boost::shared_ptr<const std::string> m_data;
+    size_t m_offset;
+    size_t m_size;
+  };
+
 	/************************************************************************/
 	/*                                                                      */
 	/************************************************************************/
 	struct i_service_endpoint
 	{
 		virtual bool do_send(const void* ptr, size_t cb)=0;
+    //! endpoints which can queue the shared buffer itself, rather than a copy, override this
+    virtual bool do_send(const shared_buffer& message) { return do_send(message.data(), message.size()); }
     virtual bool close()=0;
     virtual bool call_run_once_service_io()=0;
     virtual bool request_callback()=0;
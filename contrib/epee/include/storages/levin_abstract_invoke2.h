@@ -40,10 +40,8 @@ namespace epee
       if(!transport.is_connected())
         return false;
 
-      serialization::portable_storage stg;
-      out_struct.store(stg);
       std::string buff_to_send, buff_to_recv;
-      stg.store_to_binary(buff_to_send);
+      serialization::store_t_to_binary(out_struct, buff_to_send);
 
       int res = transport.invoke(command, buff_to_send, buff_to_recv);
       if( res <=0 )
@@ -51,7 +49,7 @@ namespace epee
         LOG_PRINT_RED("Failed to invoke command " << command << " return code " << res, LOG_LEVEL_1);
         return false;
       }
-      serialization::portable_storage stg_ret;
+      serialization::direct_binary_reader stg_ret;
       if(!stg_ret.load_from_binary(buff_to_recv))
       {
         LOG_ERROR("Failed to load_from_binary on command " << command);
@@ -67,10 +65,8 @@ namespace epee
       if(!transport.is_connected())
         return false;
 
-      serialization::portable_storage stg;
-      out_struct.store(&stg);
       std::string buff_to_send;
-      stg.store_to_binary(buff_to_send);
+      serialization::store_t_to_binary(out_struct, buff_to_send);
 
       int res = transport.notify(command, buff_to_send);
       if(res <=0 )
@@ -85,10 +81,8 @@ namespace epee
     bool invoke_remote_command2(boost::uuids::uuid conn_id, int command, const t_arg& out_struct, t_result& result_struct, t_transport& transport)
     {
 
-      typename serialization::portable_storage stg;
-      out_struct.store(stg);
       std::string buff_to_send, buff_to_recv;
-      stg.store_to_binary(buff_to_send);
+      serialization::store_t_to_binary(out_struct, buff_to_send);
 
       int res = transport.invoke(command, buff_to_send, buff_to_recv, conn_id);
       if( res <=0 )
@@ -96,7 +90,7 @@ namespace epee
         LOG_PRINT_L1("Failed to invoke command " << command << " return code " << res);
         return false;
       }
-      typename serialization::portable_storage stg_ret;
+      serialization::direct_binary_reader stg_ret;
       if(!stg_ret.load_from_binary(buff_to_recv))
       {
         LOG_ERROR("Failed to load_from_binary on command " << command);
@@ -110,10 +104,8 @@ namespace epee
     template<class t_result, class t_arg, class callback_t, class t_transport>
     bool async_invoke_remote_command2(boost::uuids::uuid conn_id, int command, const t_arg& out_struct, t_transport& transport, callback_t cb, size_t inv_timeout = LEVIN_DEFAULT_TIMEOUT_PRECONFIGURED)
     {
-      typename serialization::portable_storage stg;
-      const_cast<t_arg&>(out_struct).store(stg);//TODO: add true const support to searilzation
       std::string buff_to_send, buff_to_recv;
-      stg.store_to_binary(buff_to_send);
+      serialization::store_t_to_binary(out_struct, buff_to_send);
       int res = transport.invoke_async(command, buff_to_send, conn_id, [cb, command](int code, const std::string& buff, typename t_transport::connection_context& context)->bool 
       {
         t_result result_struct = AUTO_VAL_INIT(result_struct);
@@ -123,7 +115,7 @@ namespace epee
           cb(code, result_struct, context);
           return false;
         }
-        serialization::portable_storage stg_ret;
+        serialization::direct_binary_reader stg_ret;
         if(!stg_ret.load_from_binary(buff))
         {
           LOG_ERROR("Failed to load_from_binary on command " << command);
@@ -146,10 +138,8 @@ namespace epee
     bool notify_remote_command2(boost::uuids::uuid conn_id, int command, const t_arg& out_struct, t_transport& transport)
     {
 
-      serialization::portable_storage stg;
-      out_struct.store(stg);
       std::string buff_to_send, buff_to_recv;
-      stg.store_to_binary(buff_to_send);
+      serialization::store_t_to_binary(out_struct, buff_to_send);
 
       int res = transport.notify(command, buff_to_send, conn_id);
       if(res <=0 )
@@ -164,7 +154,7 @@ namespace epee
     template<class t_owner, class t_in_type, class t_out_type, class t_context, class callback_t>
     int buff_to_t_adapter(int command, const std::string& in_buff, std::string& buff_out, callback_t cb, t_context& context )
     {
-      serialization::portable_storage strg;
+      serialization::direct_binary_reader strg;
       if(!strg.load_from_binary(in_buff))
       {
         LOG_ERROR("Failed to load_from_binary in command " << command);
@@ -175,10 +165,7 @@ namespace epee
 
       static_cast<t_in_type&>(in_struct).load(strg);
       int res = cb(command, static_cast<t_in_type&>(in_struct), static_cast<t_out_type&>(out_struct), context);
-      serialization::portable_storage strg_out;
-      static_cast<t_out_type&>(out_struct).store(strg_out);
-
-      if(!strg_out.store_to_binary(buff_out))
+      if(!serialization::store_t_to_binary(static_cast<t_out_type&>(out_struct), buff_out))
       {
         LOG_ERROR("Failed to store_to_binary in command" << command);
         return -1;
@@ -190,7 +177,7 @@ namespace epee
     template<class t_owner, class t_in_type, class t_context, class callback_t>
     int buff_to_t_adapter(t_owner* powner, int command, const std::string& in_buff, callback_t cb, t_context& context)
     {
-      serialization::portable_storage strg;
+      serialization::direct_binary_reader strg;
       if(!strg.load_from_binary(in_buff))
       {
         LOG_ERROR("Failed to load_from_binary in notify " << command);
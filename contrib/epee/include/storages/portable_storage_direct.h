@@ -0,0 +1,828 @@
+// Copyright (c) 2006-2013, Andrey N. Sabelnikov, www.sabelnikov.net
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Andrey N. Sabelnikov nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER  BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "misc_language.h"
+#include "portable_storage_base.h"
+#include "portable_storage_to_bin.h"
+#include "portable_storage_from_bin.h"
+#include "portable_storage_to_json.h"
+#include "portable_storage_val_converters.h"
+
+/*
+ * Storages for the KV serialization maps which go straight between the
+ * structs and the wire format, instead of through a portable_storage tree.
+ * They have the same interface as portable_storage as far as the maps use
+ * it, so the same store()/load() instantiate against them.
+ *
+ * The writers produce the very same bytes as a portable_storage would: a
+ * section keeps its entries in a std::map there, so they come out sorted by
+ * name whatever order the map stores them in. The writers append entries as
+ * they come and put each section in order when it is closed, which the maps
+ * always do before going on with its parent.
+ *
+ * The binary reader indexes a section's entries the first time the section
+ * is opened, and decodes values straight from the buffer when asked for,
+ * with the same conversions as portable_storage.
+ */
+
+namespace epee
+{
+  namespace serialization
+  {
+    /************************************************************************/
+    /* writers                                                              */
+    /************************************************************************/
+    struct string_write_adapter
+    {
+      std::string& m_str;
+      string_write_adapter(std::string& str):m_str(str){}
+      void write(const char* data, size_t size){ m_str.append(data, size); }
+    };
+
+    /**
+     * Keeps track of the sections and arrays being written, and puts a
+     * section's entries in name order when it is closed. The format specific
+     * parts are left to t_format (CRTP).
+     */
+    template<class t_format>
+    class direct_writer_base
+    {
+    public:
+      struct frame
+      {
+        size_t depth;
+        bool is_array;
+        size_t begin;         // where the section or array starts in the output
+        size_t count;         // entries or elements written so far
+        size_t first_entry;   // index of the section's first entry in m_entries
+        size_t indent;
+      };
+      typedef frame* hsection;
+      typedef frame* harray;
+      typedef storage_entry meta_entry;
+
+      direct_writer_base(std::string& target):m_out(target){}
+
+      bool finish()
+      {
+        while(m_frames.size())
+          close_top();
+        return true;
+      }
+
+    protected:
+      struct entry
+      {
+        std::string name;
+        size_t begin;
+      };
+
+      t_format& format(){ return static_cast<t_format&>(*this); }
+
+      frame& push_frame(bool is_array, size_t indent)
+      {
+        frame f = {m_frames.size(), is_array, m_out.size(), 0, m_entries.size(), indent};
+        m_frames.push_back(f);
+        return m_frames.back();
+      }
+
+      frame& resolve(frame* f)
+      {
+        return f ? *f : m_frames.front();
+      }
+
+      //closes whatever the map opened below f, it will not come back to it
+      void close_above(const frame& f)
+      {
+        while(m_frames.size() > f.depth + 1)
+          close_top();
+      }
+
+      frame& begin_entry(frame* hsec, const char* name)
+      {
+        frame& f = resolve(hsec);
+        close_above(f);
+        CHECK_AND_ASSERT_THROW_MES(!f.is_array, "direct writer: value added to an array as a named entry");
+        m_entries.push_back(entry{name, m_out.size()});
+        ++f.count;
+        format().write_name(f, m_entries.back().name);
+        return f;
+      }
+
+      frame& next_element(frame* harr)
+      {
+        CHECK_AND_ASSERT_THROW_MES(harr && harr->is_array, "direct writer: bad array handle");
+        close_above(*harr);
+        ++harr->count;
+        return *harr;
+      }
+
+
+      void close_top()
+      {
+        frame& f = m_frames.back();
+        if(f.is_array)
+        {
+          format().close_array(f);
+        }
+        else
+        {
+          const size_t content_begin = f.begin + format().section_prefix_size();
+          const size_t content_end = m_out.size();
+          typename std::vector<entry>::iterator first = m_entries.begin() + f.first_entry;
+          std::vector<size_t> ends(m_entries.end() - first);
+          for(size_t i = 0; i < ends.size(); ++i)
+            ends[i] = i + 1 < ends.size() ? first[i + 1].begin : content_end;
+
+          std::vector<size_t> order(ends.size());
+          for(size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+          std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return first[a].name < first[b].name; });
+
+          //a value set twice replaces the first one, as in a portable_storage section
+          std::vector<size_t> kept;
+          kept.reserve(order.size());
+          for(size_t i = 0; i < order.size(); ++i)
+          {
+            if(i + 1 < order.size() && first[order[i]].name == first[order[i + 1]].name)
+              continue;
+            kept.push_back(order[i]);
+          }
+
+          bool in_order = kept.size() == order.size();
+          for(size_t i = 0; in_order && i < kept.size(); ++i)
+            in_order = kept[i] == i;
+
+          if(in_order && format().patch_section(f, kept.size()))
+          {
+            //already in place
+          }
+          else
+          {
+            std::string content = m_out.substr(content_begin);
+            m_out.resize(f.begin);
+            format().open_section_text(f, kept.size());
+            for(size_t i = 0; i < kept.size(); ++i)
+            {
+              const size_t idx = kept[i];
+              m_out.append(content, first[idx].begin - content_begin, ends[idx] - first[idx].begin);
+              format().after_entry(f, i + 1 == kept.size());
+            }
+            format().close_section_text(f, kept.size());
+          }
+          m_entries.resize(f.first_entry);
+        }
+        m_frames.pop_back();
+      }
+
+      std::string& m_out;
+      std::deque<frame> m_frames;
+      std::vector<entry> m_entries;
+    };
+
+    /**
+     * Writes a KV serializable struct straight into the portable_storage
+     * binary format.
+     */
+    class direct_binary_writer: public direct_writer_base<direct_binary_writer>
+    {
+      friend class direct_writer_base<direct_binary_writer>;
+#pragma pack(push)
+#pragma pack(1)
+      struct storage_block_header
+      {
+        uint32_t m_signature_a;
+        uint32_t m_signature_b;
+        uint8_t  m_ver;
+      };
+#pragma pack(pop)
+    public:
+      direct_binary_writer(std::string& target):direct_writer_base<direct_binary_writer>(target), m_strm(target)
+      {
+        storage_block_header sbh = AUTO_VAL_INIT(sbh);
+        sbh.m_signature_a = PORTABLE_STORAGE_SIGNATUREA;
+        sbh.m_signature_b = PORTABLE_STORAGE_SIGNATUREB;
+        sbh.m_ver = PORTABLE_STORAGE_FORMAT_VER;
+        m_out.assign((const char*)&sbh, sizeof(sbh));
+        push_frame(false, 0);
+        m_out.push_back(0);
+      }
+
+      hsection open_section(const char* name, hsection hparent_section, bool create_if_notexist = true)
+      {
+        begin_entry(hparent_section, name);
+        put_type(SERIALIZE_TYPE_OBJECT);
+        frame& child = push_frame(false, 0);
+        m_out.push_back(0);
+        return &child;
+      }
+
+      template<class t_value>
+      bool set_value(const char* name, const t_value& v, hsection hparent_section)
+      {
+        begin_entry(hparent_section, name);
+        put_type(type_of(v));
+        put(v);
+        return true;
+      }
+
+      bool set_value(const char* name, const storage_entry& v, hsection hparent_section)
+      {
+        begin_entry(hparent_section, name);
+        pack_entry_to_buff(m_strm, v);
+        return true;
+      }
+
+      template<class t_value>
+      harray insert_first_value(const char* name, const t_value& v, hsection hparent_section)
+      {
+        begin_entry(hparent_section, name);
+        put_type(type_of(v) | SERIALIZE_FLAG_ARRAY);
+        frame& arr = push_frame(true, 0);
+        m_out.push_back(0);
+        ++arr.count;
+        put(v);
+        return &arr;
+      }
+
+      template<class t_value>
+      bool insert_next_value(harray hval_array, const t_value& v)
+      {
+        next_element(hval_array);
+        put(v);
+        return true;
+      }
+
+      harray insert_first_section(const char* name, hsection& hinserted_childsection, hsection hparent_section)
+      {
+        begin_entry(hparent_section, name);
+        put_type(SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY);
+        frame& arr = push_frame(true, 0);
+        m_out.push_back(0);
+        ++arr.count;
+        hinserted_childsection = &push_frame(false, 0);
+        m_out.push_back(0);
+        return &arr;
+      }
+
+      bool insert_next_section(harray hsec_array, hsection& hinserted_childsection)
+      {
+        next_element(hsec_array);
+        hinserted_childsection = &push_frame(false, 0);
+        m_out.push_back(0);
+        return true;
+      }
+
+    private:
+      static uint8_t type_of(const uint64_t&){ return SERIALIZE_TYPE_UINT64; }
+      static uint8_t type_of(const uint32_t&){ return SERIALIZE_TYPE_UINT32; }
+      static uint8_t type_of(const uint16_t&){ return SERIALIZE_TYPE_UINT16; }
+      static uint8_t type_of(const uint8_t&) { return SERIALIZE_TYPE_UINT8; }
+      static uint8_t type_of(const int64_t&) { return SERIALIZE_TYPE_INT64; }
+      static uint8_t type_of(const int32_t&) { return SERIALIZE_TYPE_INT32; }
+      static uint8_t type_of(const int16_t&) { return SERIALIZE_TYPE_INT16; }
+      static uint8_t type_of(const int8_t&)  { return SERIALIZE_TYPE_INT8; }
+      static uint8_t type_of(const double&)  { return SERIALIZE_TYPE_DUOBLE; }
+      static uint8_t type_of(const bool&)    { return SERIALIZE_TYPE_BOOL; }
+      static uint8_t type_of(const std::string&){ return SERIALIZE_TYPE_STRING; }
+
+      void put_type(uint8_t type){ m_out.push_back((char)type); }
+
+      template<class t_pod_type>
+      void put(const t_pod_type& v){ m_out.append((const char*)&v, sizeof(v)); }
+      void put(const std::string& v){ put_string(m_strm, v); }
+
+      void write_name(const frame&, const std::string& name)
+      {
+        CHECK_AND_ASSERT_THROW_MES(name.size() < std::numeric_limits<uint8_t>::max(), "storage_entry_name is too long: " << name.size() << ", val: " << name);
+        m_out.push_back((char)name.size());
+        m_out += name;
+      }
+
+      //sections and arrays start with a one byte count, which is widened if need be
+      size_t section_prefix_size() const { return 1; }
+
+      bool patch_section(const frame& f, size_t count)
+      {
+        if(count > 63)
+          return false;
+        m_out[f.begin] = (char)((count << 2) | PORTABLE_RAW_SIZE_MARK_BYTE);
+        return true;
+      }
+
+      void open_section_text(const frame&, size_t count){ pack_varint(m_strm, count); }
+      void after_entry(const frame&, bool){}
+      void close_section_text(const frame&, size_t){}
+
+      void close_array(const frame& f)
+      {
+        if(patch_section(f, f.count))
+          return;
+        std::string count;
+        string_write_adapter strm(count);
+        pack_varint(strm, f.count);
+        m_out.replace(f.begin, 1, count);
+      }
+
+      string_write_adapter m_strm;
+    };
+
+    /**
+     * Writes a KV serializable struct straight into the JSON portable_storage
+     * would dump it as.
+     */
+    class direct_json_writer: public direct_writer_base<direct_json_writer>
+    {
+      friend class direct_writer_base<direct_json_writer>;
+    public:
+      direct_json_writer(std::string& target, size_t indent = 0, bool insert_newlines = true):
+        direct_writer_base<direct_json_writer>(target), m_newline(insert_newlines ? "\r\n" : "")
+      {
+        m_out.clear();
+        push_frame(false, indent);
+      }
+
+      hsection open_section(const char* name, hsection hparent_section, bool create_if_notexist = true)
+      {
+        frame& parent = begin_entry(hparent_section, name);
+        return &push_frame(false, parent.indent + 1);
+      }
+
+      template<class t_value>
+      bool set_value(const char* name, const t_value& v, hsection hparent_section)
+      {
+        begin_entry(hparent_section, name);
+        put(v);
+        return true;
+      }
+
+      bool set_value(const char* name, const storage_entry& v, hsection hparent_section)
+      {
+        frame& parent = begin_entry(hparent_section, name);
+        std::stringstream ss;
+        dump_as_json(ss, v, parent.indent + 1, !m_newline.empty());
+        m_out += ss.str();
+        return true;
+      }
+
+      template<class t_value>
+      harray insert_first_value(const char* name, const t_value& v, hsection hparent_section)
+      {
+        frame& parent = begin_entry(hparent_section, name);
+        m_out.push_back('[');
+        frame& arr = push_frame(true, parent.indent + 1);
+        ++arr.count;
+        put(v);
+        return &arr;
+      }
+
+      template<class t_value>
+      bool insert_next_value(harray hval_array, const t_value& v)
+      {
+        next_element(hval_array);
+        m_out.push_back(',');
+        put(v);
+        return true;
+      }
+
+      harray insert_first_section(const char* name, hsection& hinserted_childsection, hsection hparent_section)
+      {
+        frame& parent = begin_entry(hparent_section, name);
+        m_out.push_back('[');
+        frame& arr = push_frame(true, parent.indent + 1);
+        ++arr.count;
+        hinserted_childsection = &push_frame(false, arr.indent);
+        return &arr;
+      }
+
+      bool insert_next_section(harray hsec_array, hsection& hinserted_childsection)
+      {
+        frame& arr = next_element(hsec_array);
+        m_out.push_back(',');
+        hinserted_childsection = &push_frame(false, arr.indent);
+        return true;
+      }
+
+    private:
+      void put(const std::string& v){ m_out += "\""; m_out += misc_utils::parse::transform_to_escape_sequence(v); m_out += "\""; }
+      void put(const int8_t& v){ m_out += std::to_string(static_cast<int32_t>(v)); }
+      void put(const uint8_t& v){ m_out += std::to_string(static_cast<int32_t>(v)); }
+      void put(const bool& v){ m_out += v ? "true" : "false"; }
+      void put(const double& v){ std::stringstream ss; ss << v; m_out += ss.str(); }
+      template<class t_type>
+      void put(const t_type& v){ m_out += std::to_string(v); }
+
+      void write_name(const frame& f, const std::string& name)
+      {
+        m_out += make_indent(f.indent + 1);
+        m_out += "\"";
+        m_out += misc_utils::parse::transform_to_escape_sequence(name);
+        m_out += "\": ";
+      }
+
+      //the braces and separators go in when the section is closed
+      size_t section_prefix_size() const { return 0; }
+      bool patch_section(const frame&, size_t){ return false; }
+
+      void open_section_text(const frame&, size_t)
+      {
+        m_out += "{";
+        m_out += m_newline;
+      }
+
+      void after_entry(const frame&, bool last)
+      {
+        if(!last)
+          m_out += ",";
+        m_out += m_newline;
+      }
+
+      void close_section_text(const frame& f, size_t)
+      {
+        m_out += make_indent(f.indent);
+        m_out += "}";
+      }
+
+      void close_array(const frame&){ m_out.push_back(']'); }
+
+      std::string m_newline;
+    };
+
+    /************************************************************************/
+    /* binary reader                                                        */
+    /************************************************************************/
+    /**
+     * Loads a KV serializable struct straight from the portable_storage
+     * binary format.
+     */
+    class direct_binary_reader
+    {
+    public:
+      struct entry_ref
+      {
+        const uint8_t* name;
+        size_t name_len;
+        const uint8_t* value;   // the type byte, followed by the value
+      };
+      struct section_index
+      {
+        std::vector<entry_ref> entries;
+      };
+      struct array_cursor
+      {
+        uint8_t type;           // without SERIALIZE_FLAG_ARRAY
+        size_t left;
+        const uint8_t* next;
+      };
+      typedef section_index* hsection;
+      typedef array_cursor* harray;
+      typedef storage_entry meta_entry;
+
+      direct_binary_reader():m_begin(nullptr), m_end(nullptr){}
+
+      bool load_from_binary(const std::string& source)
+      {
+        m_sections.clear();
+        m_arrays.clear();
+        if(source.size() < sizeof(storage_block_header))
+        {
+          LOG_ERROR("portable_storage: wrong binary format, packet size = " << source.size() << " less than expected sizeof(storage_block_header)=" << sizeof(storage_block_header));
+          return false;
+        }
+        const storage_block_header* pbuff = (const storage_block_header*)source.data();
+        if(pbuff->m_signature_a != PORTABLE_STORAGE_SIGNATUREA ||
+          pbuff->m_signature_b != PORTABLE_STORAGE_SIGNATUREB
+          )
+        {
+          LOG_ERROR("portable_storage: wrong binary format - signature missmatch");
+          return false;
+        }
+        if(pbuff->m_ver != PORTABLE_STORAGE_FORMAT_VER)
+        {
+          LOG_ERROR("portable_storage: wrong binary format - unknown format ver = " << pbuff->m_ver);
+          return false;
+        }
+        TRY_ENTRY();
+        m_begin = (const uint8_t*)source.data() + sizeof(storage_block_header);
+        m_end = (const uint8_t*)source.data() + source.size();
+        CHECK_AND_ASSERT_THROW_MES(m_begin != m_end, "throwable_buffer_reader: sz==0");
+        //indexing the root walks, and so checks, the whole tree
+        m_sections.push_back(section_index());
+        index_section(m_sections.back(), m_begin, 0);
+        return true;
+        CATCH_ENTRY("portable_storage::load_from_binary", false);
+      }
+
+      hsection open_section(const char* name, hsection hparent_section, bool create_if_notexist = false)
+      {
+        const entry_ref* e = find(hparent_section, name);
+        if(!e || *e->value != SERIALIZE_TYPE_OBJECT)
+          return create_if_notexist ? &m_empty : nullptr;
+        return new_section(e->value + 1);
+      }
+
+      template<class t_value>
+      bool get_value(const char* name, t_value& val, hsection hparent_section)
+      {
+        const entry_ref* e = find(hparent_section, name);
+        if(!e)
+          return false;
+        const uint8_t* p = e->value + 1;
+        CHECK_AND_ASSERT_THROW_MES(!(*e->value & SERIALIZE_FLAG_ARRAY) && *e->value != SERIALIZE_TYPE_OBJECT && *e->value != SERIALIZE_TYPE_ARRAY,
+          "WRONG DATA CONVERSION: from a section or an array to type " << typeid(t_value).name());
+        read_value(*e->value, p, val);
+        return true;
+      }
+
+      bool get_value(const char* name, storage_entry& val, hsection hparent_section)
+      {
+        const entry_ref* e = find(hparent_section, name);
+        if(!e)
+          return false;
+        throwable_buffer_reader reader(e->value, m_end - e->value);
+        val = reader.load_storage_entry();
+        return true;
+      }
+
+      template<class t_value>
+      harray get_first_value(const char* name, t_value& target, hsection hparent_section)
+      {
+        array_cursor* cursor = open_array(hparent_section, name);
+        if(!cursor)
+          return nullptr;
+        if(!get_next_value(cursor, target))
+          return nullptr;
+        return cursor;
+      }
+
+      template<class t_value>
+      bool get_next_value(harray hval_array, t_value& target)
+      {
+        CHECK_AND_ASSERT(hval_array, false);
+        if(!hval_array->left)
+          return false;
+        CHECK_AND_ASSERT_THROW_MES(hval_array->type != SERIALIZE_TYPE_OBJECT && hval_array->type != SERIALIZE_TYPE_ARRAY,
+          "WRONG DATA CONVERSION: from a section or an array to type " << typeid(t_value).name());
+        read_value(hval_array->type, hval_array->next, target);
+        --hval_array->left;
+        return true;
+      }
+
+      harray get_first_section(const char* name, hsection& h_child_section, hsection hparent_section)
+      {
+        array_cursor* cursor = open_array(hparent_section, name);
+        if(!cursor || cursor->type != SERIALIZE_TYPE_OBJECT)
+          return nullptr;
+        if(!get_next_section(cursor, h_child_section))
+          return nullptr;
+        return cursor;
+      }
+
+      bool get_next_section(harray hsec_array, hsection& h_child_section)
+      {
+        CHECK_AND_ASSERT(hsec_array, false);
+        if(!hsec_array->left || hsec_array->type != SERIALIZE_TYPE_OBJECT)
+          return false;
+        m_sections.push_back(section_index());
+        hsec_array->next = index_section(m_sections.back(), hsec_array->next, 0);
+        h_child_section = &m_sections.back();
+        --hsec_array->left;
+        return true;
+      }
+
+    private:
+#pragma pack(push)
+#pragma pack(1)
+      struct storage_block_header
+      {
+        uint32_t m_signature_a;
+        uint32_t m_signature_b;
+        uint8_t  m_ver;
+      };
+#pragma pack(pop)
+
+      void need(const uint8_t* p, size_t count) const
+      {
+        CHECK_AND_ASSERT_THROW_MES(p <= m_end && (size_t)(m_end - p) >= count, " attempt to read " << count << " bytes from buffer with " << (p <= m_end ? m_end - p : 0) << " bytes remained");
+      }
+
+      template<class t_pod_type>
+      t_pod_type read_pod(const uint8_t*& p) const
+      {
+        need(p, sizeof(t_pod_type));
+        t_pod_type v;
+        memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+        return v;
+      }
+
+      size_t read_varint(const uint8_t*& p) const
+      {
+        need(p, 1);
+        size_t v = 0;
+        switch(*p & PORTABLE_RAW_SIZE_MARK_MASK)
+        {
+        case PORTABLE_RAW_SIZE_MARK_BYTE: v = read_pod<uint8_t>(p); break;
+        case PORTABLE_RAW_SIZE_MARK_WORD: v = read_pod<uint16_t>(p); break;
+        case PORTABLE_RAW_SIZE_MARK_DWORD: v = read_pod<uint32_t>(p); break;
+        case PORTABLE_RAW_SIZE_MARK_INT64: v = read_pod<uint64_t>(p); break;
+        }
+        return v >> 2;
+      }
+
+      size_t read_string_size(const uint8_t*& p) const
+      {
+        size_t len = read_varint(p);
+        CHECK_AND_ASSERT_THROW_MES(len < MAX_STRING_LEN_POSSIBLE, "to big string len value in storage: " << len);
+        need(p, len);
+        return len;
+      }
+
+      static size_t pod_size(uint8_t type)
+      {
+        switch(type)
+        {
+        case SERIALIZE_TYPE_INT64: case SERIALIZE_TYPE_UINT64: case SERIALIZE_TYPE_DUOBLE: return 8;
+        case SERIALIZE_TYPE_INT32: case SERIALIZE_TYPE_UINT32: return 4;
+        case SERIALIZE_TYPE_INT16: case SERIALIZE_TYPE_UINT16: return 2;
+        case SERIALIZE_TYPE_INT8: case SERIALIZE_TYPE_UINT8: case SERIALIZE_TYPE_BOOL: return 1;
+        default: return 0;
+        }
+      }
+
+      //steps over one value of the given type, checking it fits in the buffer
+      const uint8_t* skip_value(uint8_t type, const uint8_t* p, size_t depth) const
+      {
+        CHECK_AND_ASSERT_THROW_MES(depth < EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL, "Wrong blob data in portable storage: recursion limitation (" << EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL << ") exceeded");
+        if(type & SERIALIZE_FLAG_ARRAY)
+        {
+          type &= ~SERIALIZE_FLAG_ARRAY;
+          CHECK_AND_ASSERT_THROW_MES(type != SERIALIZE_TYPE_ARRAY, "Reading array entry is not supported");
+          size_t count = read_varint(p);
+          while(count--)
+            p = skip_value(type, p, depth + 1);
+          return p;
+        }
+        switch(type)
+        {
+        case SERIALIZE_TYPE_STRING:
+          {
+            size_t len = read_string_size(p);
+            return p + len;
+          }
+        case SERIALIZE_TYPE_OBJECT:
+          {
+            size_t count = read_varint(p);
+            while(count--)
+            {
+              size_t name_len = read_pod<uint8_t>(p);
+              need(p, name_len);
+              p += name_len;
+              uint8_t entry_type = read_pod<uint8_t>(p);
+              p = skip_value(entry_type, p, depth + 1);
+            }
+            return p;
+          }
+        case SERIALIZE_TYPE_ARRAY:
+          CHECK_AND_ASSERT_THROW_MES(false, "Reading array entry is not supported");
+        default:
+          {
+            size_t size = pod_size(type);
+            CHECK_AND_ASSERT_THROW_MES(size, "unknown entry_type code = " << type);
+            need(p, size);
+            return p + size;
+          }
+        }
+      }
+
+      const uint8_t* index_section(section_index& sec, const uint8_t* p, size_t depth)
+      {
+        size_t count = read_varint(p);
+        sec.entries.reserve(std::min<size_t>(count, (m_end - p) / 3));
+        while(count--)
+        {
+          entry_ref e;
+          e.name_len = read_pod<uint8_t>(p);
+          need(p, e.name_len);
+          e.name = p;
+          p += e.name_len;
+          e.value = p;
+          uint8_t type = read_pod<uint8_t>(p);
+          p = skip_value(type, p, depth + 1);
+          sec.entries.push_back(e);
+        }
+        return p;
+      }
+
+      section_index* new_section(const uint8_t* p)
+      {
+        m_sections.push_back(section_index());
+        index_section(m_sections.back(), p, 0);
+        return &m_sections.back();
+      }
+
+      //the first entry of that name, as a portable_storage section keeps the first one
+      const entry_ref* find(hsection hsec, const char* name)
+      {
+        const section_index& sec = hsec ? *hsec : m_sections.front();
+        const size_t len = strlen(name);
+        for(const entry_ref& e: sec.entries)
+        {
+          if(e.name_len == len && !memcmp(e.name, name, len))
+            return &e;
+        }
+        return nullptr;
+      }
+
+      array_cursor* open_array(hsection hsec, const char* name)
+      {
+        const entry_ref* e = find(hsec, name);
+        if(!e || !(*e->value & SERIALIZE_FLAG_ARRAY))
+          return nullptr;
+        array_cursor cursor;
+        cursor.type = *e->value & ~SERIALIZE_FLAG_ARRAY;
+        cursor.next = e->value + 1;
+        cursor.left = read_varint(cursor.next);
+        if(!cursor.left)
+          return nullptr;
+        m_arrays.push_back(cursor);
+        return &m_arrays.back();
+      }
+
+      template<class t_value>
+      void read_value(uint8_t type, const uint8_t*& p, t_value& val) const
+      {
+        switch(type)
+        {
+        case SERIALIZE_TYPE_INT64:  convert_t(read_pod<int64_t>(p), val); break;
+        case SERIALIZE_TYPE_INT32:  convert_t(read_pod<int32_t>(p), val); break;
+        case SERIALIZE_TYPE_INT16:  convert_t(read_pod<int16_t>(p), val); break;
+        case SERIALIZE_TYPE_INT8:   convert_t(read_pod<int8_t>(p), val); break;
+        case SERIALIZE_TYPE_UINT64: convert_t(read_pod<uint64_t>(p), val); break;
+        case SERIALIZE_TYPE_UINT32: convert_t(read_pod<uint32_t>(p), val); break;
+        case SERIALIZE_TYPE_UINT16: convert_t(read_pod<uint16_t>(p), val); break;
+        case SERIALIZE_TYPE_UINT8:  convert_t(read_pod<uint8_t>(p), val); break;
+        case SERIALIZE_TYPE_DUOBLE: convert_t(read_pod<double>(p), val); break;
+        case SERIALIZE_TYPE_BOOL:   convert_t(read_pod<uint8_t>(p) != 0, val); break;
+        case SERIALIZE_TYPE_STRING:
+          {
+            size_t len = read_string_size(p);
+            convert_t(std::string((const char*)p, len), val);
+            p += len;
+            break;
+          }
+        default:
+          CHECK_AND_ASSERT_THROW_MES(false, "unknown entry_type code = " << type);
+        }
+      }
+
+      void read_value(uint8_t type, const uint8_t*& p, std::string& val) const
+      {
+        CHECK_AND_ASSERT_THROW_MES(type == SERIALIZE_TYPE_STRING, "WRONG DATA CONVERSION: from type=" << (int)type << " to type " << typeid(val).name());
+        size_t len = read_string_size(p);
+        val.assign((const char*)p, len);
+        p += len;
+      }
+
+      const uint8_t* m_begin;
+      const uint8_t* m_end;
+      std::deque<section_index> m_sections;
+      std::deque<array_cursor> m_arrays;
+      section_index m_empty;
+    };
+  }
+}
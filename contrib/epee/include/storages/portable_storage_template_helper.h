@@ -30,6 +30,7 @@
 
 #include "parserse_base_utils.h"
 #include "portable_storage.h"
+#include "portable_storage_direct.h"
 #include "file_io_utils.h"
 
 namespace epee
@@ -61,10 +62,11 @@ namespace epee
     template<class t_struct>
     bool store_t_to_json(t_struct& str_in, std::string& json_buff, size_t indent = 0, bool insert_newlines = true)
     {
-      portable_storage ps;
-      str_in.store(ps);
-      ps.dump_as_json(json_buff, indent, insert_newlines);
-      return true;
+      TRY_ENTRY();
+      direct_json_writer stg(json_buff, indent, insert_newlines);
+      str_in.store(stg);
+      return stg.finish();
+      CATCH_ENTRY("serialization::store_t_to_json", false);
     }
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
@@ -86,12 +88,12 @@ namespace epee
     template<class t_struct>
     bool load_t_from_binary(t_struct& out, const std::string& binary_buff)
     {
-      portable_storage ps;
-      bool rs = ps.load_from_binary(binary_buff);
+      direct_binary_reader stg;
+      bool rs = stg.load_from_binary(binary_buff);
       if(!rs)
         return false;
 
-      return out.load(ps);
+      return out.load(stg);
     }
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
@@ -107,9 +109,11 @@ namespace epee
     template<class t_struct>
     bool store_t_to_binary(t_struct& str_in, std::string& binary_buff, size_t indent = 0)
     {
-      portable_storage ps;
-      str_in.store(ps);
-      return ps.store_to_binary(binary_buff);
+      TRY_ENTRY();
+      direct_binary_writer stg(binary_buff);
+      str_in.store(stg);
+      return stg.finish();
+      CATCH_ENTRY("serialization::store_t_to_binary", false);
     }
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
@@ -726,9 +726,7 @@ blobdata BlockchainBDB::output_to_blob(const tx_out& output) const
 tx_out BlockchainBDB::output_from_blob(const blobdata& blob) const
 {
     LOG_PRINT_L3("BlockchainBDB::" << __func__);
-    std::stringstream ss;
-    ss << blob;
-    binary_archive<false> ba(ss);
+    binary_archive<false> ba{epee::strspan<std::uint8_t>(blob)};
     tx_out o;
 
     if (!(::serialization::serialize(ba, o)))
@@ -1810,6 +1808,20 @@ bool BlockchainBDB::has_key_image(const crypto::key_image& img) const
     return false;
 }
 
+// Block filters are not stored by the BerkeleyDB backend; callers fall
+// back to fetching full blocks.
+bool BlockchainBDB::get_block_filter(const uint64_t& height, blobdata& filter) const
+{
+    LOG_PRINT_L3("BlockchainBDB::" << __func__);
+    check_open();
+    return false;
+}
+
+void BlockchainBDB::add_block_filter(const blobdata& filter)
+{
+    LOG_PRINT_L3("BlockchainBDB::" << __func__);
+}
+
 // Ostensibly BerkeleyDB has batch transaction support built-in,
 // so the following few functions will be NOP.
 
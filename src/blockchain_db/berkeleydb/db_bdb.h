@@ -317,6 +317,8 @@ public:
 
   virtual bool has_key_image(const crypto::key_image& img) const;
 
+  virtual bool get_block_filter(const uint64_t& height, blobdata& filter) const;
+
   virtual uint64_t add_block( const block& blk
                             , const size_t& block_size
                             , const difficulty_type& cumulative_difficulty
@@ -361,6 +363,8 @@ private:
 
   virtual void remove_block();
 
+  virtual void add_block_filter(const blobdata& filter);
+
   virtual void add_transaction_data(const crypto::hash& blk_hash, const transaction& tx, const crypto::hash& tx_hash);
 
   virtual void remove_transaction_data(const crypto::hash& tx_hash, const transaction& tx);
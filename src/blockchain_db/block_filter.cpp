@@ -0,0 +1,232 @@
+// Copyright (c) 2017-2018, The Bixbite Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "block_filter.h"
+#include "common/int-util.h"
+#include "common/varint.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+
+namespace
+{
+  using cryptonote::block_filter_element;
+
+  uint64_t hash_to_range(const crypto::hash& block_hash, const block_filter_element& element, uint64_t range)
+  {
+    char data[sizeof(crypto::hash) + sizeof(block_filter_element)];
+    memcpy(data, &block_hash, sizeof(crypto::hash));
+    memcpy(data + sizeof(crypto::hash), &element, sizeof(block_filter_element));
+    crypto::hash h;
+    crypto::cn_fast_hash(data, sizeof(data), h);
+    uint64_t v;
+    memcpy(&v, &h, sizeof(v));
+    uint64_t hi;
+    mul128(SWAP64LE(v), range, &hi);
+    return hi;
+  }
+
+  std::vector<uint64_t> hash_elements(const crypto::hash& block_hash, const std::vector<block_filter_element>& elements, uint64_t range)
+  {
+    std::vector<uint64_t> values;
+    values.reserve(elements.size());
+    for (const block_filter_element& e: elements)
+      values.push_back(hash_to_range(block_hash, e, range));
+    std::sort(values.begin(), values.end());
+    return values;
+  }
+
+  class bit_writer
+  {
+  public:
+    bit_writer(std::string& out): m_out(out), m_acc(0), m_nbits(0) {}
+    void write_bit(bool bit)
+    {
+      m_acc = (m_acc << 1) | (bit ? 1 : 0);
+      if (++m_nbits == 8)
+      {
+        m_out.push_back((char)m_acc);
+        m_acc = 0;
+        m_nbits = 0;
+      }
+    }
+    void write_bits(uint64_t v, int n)
+    {
+      while (n--)
+        write_bit((v >> n) & 1);
+    }
+    void flush()
+    {
+      if (m_nbits)
+        m_out.push_back((char)(m_acc << (8 - m_nbits)));
+      m_acc = 0;
+      m_nbits = 0;
+    }
+  private:
+    std::string& m_out;
+    uint8_t m_acc;
+    int m_nbits;
+  };
+
+  class bit_reader
+  {
+  public:
+    bit_reader(const char* data, size_t size): m_data((const uint8_t*)data), m_size(size), m_bit(0) {}
+    bool read_bit(bool& bit)
+    {
+      if (m_bit >= m_size * 8)
+        return false;
+      bit = (m_data[m_bit / 8] >> (7 - m_bit % 8)) & 1;
+      ++m_bit;
+      return true;
+    }
+    bool read_bits(int n, uint64_t& v)
+    {
+      v = 0;
+      bool bit;
+      while (n--)
+      {
+        if (!read_bit(bit))
+          return false;
+        v = (v << 1) | bit;
+      }
+      return true;
+    }
+  private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_bit;
+  };
+
+  void add_key(std::vector<block_filter_element>& elements, const void* key)
+  {
+    block_filter_element e;
+    memcpy(&e, key, sizeof(e));
+    elements.push_back(e);
+  }
+
+  void add_tx_elements(const cryptonote::transaction& tx, std::vector<block_filter_element>& elements)
+  {
+    const crypto::public_key tx_pub_key = cryptonote::get_tx_pub_key_from_extra(tx);
+    if (tx_pub_key != cryptonote::null_pkey)
+      add_key(elements, &tx_pub_key);
+    for (const crypto::public_key& pk: cryptonote::get_additional_tx_pub_keys_from_extra(tx))
+      add_key(elements, &pk);
+    for (const cryptonote::tx_out& out: tx.vout)
+    {
+      if (out.target.type() == typeid(cryptonote::txout_to_key))
+        add_key(elements, &boost::get<cryptonote::txout_to_key>(out.target).key);
+    }
+    for (const cryptonote::txin_v& in: tx.vin)
+    {
+      if (in.type() == typeid(cryptonote::txin_to_key))
+        add_key(elements, &boost::get<cryptonote::txin_to_key>(in).k_image);
+    }
+  }
+}
+
+namespace cryptonote
+{
+
+void get_block_filter_elements(const block& blk, const std::vector<transaction>& txs, std::vector<block_filter_element>& elements)
+{
+  add_tx_elements(blk.miner_tx, elements);
+  for (const transaction& tx: txs)
+    add_tx_elements(tx, elements);
+}
+
+blobdata make_block_filter(const crypto::hash& block_hash, const std::vector<block_filter_element>& elements)
+{
+  blobdata filter;
+  const uint64_t n = elements.size();
+  tools::write_varint(std::back_inserter(filter), n);
+  if (n == 0)
+    return filter;
+
+  const std::vector<uint64_t> values = hash_elements(block_hash, elements, n * BLOCK_FILTER_M);
+  bit_writer writer(filter);
+  uint64_t last = 0;
+  for (uint64_t v: values)
+  {
+    const uint64_t delta = v - last;
+    last = v;
+    for (uint64_t q = delta >> BLOCK_FILTER_P; q > 0; --q)
+      writer.write_bit(true);
+    writer.write_bit(false);
+    writer.write_bits(delta, BLOCK_FILTER_P);
+  }
+  writer.flush();
+  return filter;
+}
+
+bool block_filter_match_any(const blobdata& filter, const crypto::hash& block_hash, const std::vector<block_filter_element>& elements)
+{
+  if (elements.empty())
+    return false;
+
+  uint64_t n;
+  const int read = tools::read_varint(filter.begin(), filter.end(), n);
+  if (read <= 0 || n > std::numeric_limits<uint64_t>::max() / BLOCK_FILTER_M)
+    return true;
+  if (n == 0)
+    return false;
+
+  const std::vector<uint64_t> queries = hash_elements(block_hash, elements, n * BLOCK_FILTER_M);
+  bit_reader reader(filter.data() + read, filter.size() - read);
+  std::vector<uint64_t>::const_iterator q = queries.begin();
+  uint64_t value = 0;
+  for (uint64_t i = 0; i < n; ++i)
+  {
+    uint64_t quotient = 0;
+    bool bit;
+    while (true)
+    {
+      if (!reader.read_bit(bit))
+        return true;
+      if (!bit)
+        break;
+      ++quotient;
+    }
+    uint64_t remainder;
+    if (!reader.read_bits(BLOCK_FILTER_P, remainder))
+      return true;
+    value += (quotient << BLOCK_FILTER_P) | remainder;
+
+    while (q != queries.end() && *q < value)
+      ++q;
+    if (q == queries.end())
+      return false;
+    if (*q == value)
+      return true;
+  }
+  return false;
+}
+
+}  // namespace cryptonote
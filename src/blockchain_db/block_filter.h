@@ -0,0 +1,94 @@
+// Copyright (c) 2017-2018, The Bixbite Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <vector>
+#include "crypto/hash.h"
+#include "cryptonote_core/cryptonote_basic.h"
+#include "cryptonote_protocol/blobdatatype.h"
+
+/** \file
+ * Compact per-block filters
+ *
+ * A block filter is a Golomb-Rice coded set (GCS) of every 32 byte key a
+ * wallet may be looking for in a block: transaction public keys (including
+ * additional ones), output public keys and key images, for the miner tx and
+ * every other tx in the block.
+ *
+ * Each element is hashed together with the block hash and mapped uniformly
+ * to [0, N * BLOCK_FILTER_M), where N is the number of elements. The sorted
+ * values are delta encoded, with each delta written as a unary quotient and
+ * a BLOCK_FILTER_P bit remainder. The serialized filter is a varint N
+ * followed by that bit stream.
+ *
+ * Matching has no false negatives and a false positive rate of about
+ * 1 / BLOCK_FILTER_M per queried element.
+ */
+
+#define BLOCK_FILTER_P 19
+#define BLOCK_FILTER_M 784931
+
+namespace cryptonote
+{
+
+  /** an element of a block filter: any 32 byte key */
+  typedef crypto::hash block_filter_element;
+
+  /**
+   * @brief collects the filter elements of a block
+   *
+   * @param blk the block
+   * @param txs the block's transactions, not including the miner tx
+   * @param elements return-by-reference the elements, appended to
+   */
+  void get_block_filter_elements(const block& blk, const std::vector<transaction>& txs, std::vector<block_filter_element>& elements);
+
+  /**
+   * @brief builds the serialized filter for a set of elements
+   *
+   * @param block_hash the hash of the block the elements belong to
+   * @param elements the elements, duplicates are fine
+   *
+   * @return the serialized filter
+   */
+  blobdata make_block_filter(const crypto::hash& block_hash, const std::vector<block_filter_element>& elements);
+
+  /**
+   * @brief checks whether any of the given elements may be in a filter
+   *
+   * @param filter the serialized filter
+   * @param block_hash the hash of the block the filter was built for
+   * @param elements the elements to look for
+   *
+   * @return false if none of the elements is in the filter, true if at least
+   *         one may be, or if the filter is malformed
+   */
+  bool block_filter_match_any(const blobdata& filter, const crypto::hash& block_hash, const std::vector<block_filter_element>& elements);
+
+}  // namespace cryptonote
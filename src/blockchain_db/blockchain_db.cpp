@@ -30,6 +30,7 @@
 #include <boost/range/adaptor/reversed.hpp>
 
 #include "blockchain_db.h"
+#include "block_filter.h"
 #include "cryptonote_core/cryptonote_format_utils.h"
 #include "profile_tools.h"
 
@@ -147,6 +148,10 @@ uint64_t BlockchainDB::add_block( const block& blk
   TIME_MEASURE_FINISH(time1);
   time_add_transaction += time1;
 
+  std::vector<block_filter_element> filter_elements;
+  get_block_filter_elements(blk, txs, filter_elements);
+  add_block_filter(make_block_filter(blk_hash, filter_elements));
+
   // DB's new height based on this added block is only incremented after this
   // function returns, so height() here returns the new previous height.
   uint64_t prev_height = height();
@@ -36,6 +36,7 @@
 #include <exception>
 #include "crypto/hash.h"
 #include "cryptonote_core/cryptonote_basic.h"
+#include "cryptonote_protocol/blobdatatype.h"
 #include "cryptonote_core/difficulty.h"
 #include "cryptonote_core/hardfork.h"
 
@@ -347,6 +348,20 @@ private:
    */
   virtual void remove_block() = 0;
 
+  /**
+   * @brief store the compact filter of the block being added
+   *
+   * Called from BlockchainDB::add_block once the block and its transactions
+   * have been added, so the filter belongs to the block at height().  The
+   * subclass should remove it again in remove_block().
+   *
+   * If any of this cannot be done, the subclass should throw the corresponding
+   * subclass of DB_EXCEPTION
+   *
+   * @param filter the serialized filter
+   */
+  virtual void add_block_filter(const blobdata& filter) = 0;
+
   /**
    * @brief store the transaction and its metadata
    *
@@ -1206,6 +1221,21 @@ public:
    */
   virtual bool has_key_image(const crypto::key_image& img) const = 0;
 
+  /**
+   * @brief fetch the compact filter of a block
+   *
+   * Filters are written along with each block from the moment this was
+   * introduced, so blocks stored by older versions have none.
+   *
+   * @param height the height of the block
+   * @param filter return-by-reference the serialized filter
+   *
+   * @return true if a filter is stored for that height, otherwise false
+   *
+   * @see block_filter.h
+   */
+  virtual bool get_block_filter(const uint64_t& height, blobdata& filter) const = 0;
+
   /**
    * @brief runs a function over all key images stored
    *
@@ -195,6 +195,7 @@ const char* const LMDB_SPENT_KEYS = "spent_keys";
 
 const char* const LMDB_HF_STARTING_HEIGHTS = "hf_starting_heights";
 const char* const LMDB_HF_VERSIONS = "hf_versions";
+const char* const LMDB_BLOCK_FILTERS = "block_filters";
 
 const char* const LMDB_PROPERTIES = "properties";
 
@@ -694,6 +695,33 @@ void BlockchainLMDB::remove_block()
 
   if ((result = mdb_cursor_del(m_cur_block_info, 0)))
       throw1(DB_ERROR(lmdb_error("Failed to add removal of block info to db transaction: ", result).c_str()));
+
+  // blocks added before block filters existed have none
+  CURSOR(block_filters)
+  if ((result = mdb_cursor_get(m_cur_block_filters, &k, NULL, MDB_SET)) == 0)
+  {
+    if ((result = mdb_cursor_del(m_cur_block_filters, 0)))
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of block filter to db transaction: ", result).c_str()));
+  }
+  else if (result != MDB_NOTFOUND)
+    throw1(DB_ERROR(lmdb_error("Failed to locate block filter for removal: ", result).c_str()));
+}
+
+void BlockchainLMDB::add_block_filter(const blobdata& filter)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+  mdb_txn_cursors *m_cursors = &m_wcursors;
+
+  CURSOR(block_filters)
+
+  MDB_val_set(key, m_height);
+  MDB_val_copy<blobdata> val(filter);
+  int result = mdb_cursor_put(m_cur_block_filters, &key, &val, MDB_APPEND);
+  if (result == MDB_KEYEXIST)
+    result = mdb_cursor_put(m_cur_block_filters, &key, &val, 0);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to add block filter to db transaction: ", result).c_str()));
 }
 
 uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash& blk_hash, const transaction& tx, const crypto::hash& tx_hash)
@@ -987,9 +1015,7 @@ blobdata BlockchainLMDB::output_to_blob(const tx_out& output) const
 tx_out BlockchainLMDB::output_from_blob(const blobdata& blob) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
-  std::stringstream ss;
-  ss << blob;
-  binary_archive<false> ba(ss);
+  binary_archive<false> ba{epee::strspan<std::uint8_t>(blob)};
   tx_out o;
 
   if (!(::serialization::serialize(ba, o)))
@@ -1031,6 +1057,7 @@ BlockchainLMDB::BlockchainLMDB(bool batch_transactions)
   m_height = 0;
   m_cum_size = 0;
   m_cum_count = 0;
+  m_has_block_filters = false;
 
   m_hardfork = nullptr;
 }
@@ -1130,6 +1157,19 @@ void BlockchainLMDB::open(const std::string& filename, const int mdb_flags)
 
   lmdb_db_open(txn, LMDB_HF_VERSIONS, MDB_INTEGERKEY | MDB_CREATE, m_hf_versions, "Failed to open db handle for m_hf_versions");
 
+  // block filters were added later, so a read-only open of an older db will not find them
+  m_has_block_filters = true;
+  if (mdb_flags & MDB_RDONLY)
+  {
+    result = mdb_dbi_open(txn, LMDB_BLOCK_FILTERS, MDB_INTEGERKEY, &m_block_filters);
+    if (result == MDB_NOTFOUND)
+      m_has_block_filters = false;
+    else if (result)
+      throw0(DB_OPEN_FAILURE(lmdb_error("Failed to open db handle for m_block_filters : ", result).c_str()));
+  }
+  else
+    lmdb_db_open(txn, LMDB_BLOCK_FILTERS, MDB_INTEGERKEY | MDB_CREATE, m_block_filters, "Failed to open db handle for m_block_filters");
+
   lmdb_db_open(txn, LMDB_PROPERTIES, MDB_CREATE, m_properties, "Failed to open db handle for m_properties");
 
   mdb_set_dupsort(txn, m_spent_keys, compare_hash32);
@@ -1294,6 +1334,8 @@ void BlockchainLMDB::reset()
   (void)mdb_drop(txn, m_hf_starting_heights, 0); // this one is dropped in new code
   if (auto result = mdb_drop(txn, m_hf_versions, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_hf_versions: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_block_filters, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_block_filters: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_properties, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_properties: ", result).c_str()));
 
@@ -2128,6 +2170,34 @@ bool BlockchainLMDB::has_key_image(const crypto::key_image& img) const
   return ret;
 }
 
+bool BlockchainLMDB::get_block_filter(const uint64_t& height, blobdata& filter) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  if (!m_has_block_filters)
+    return false;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(block_filters);
+
+  MDB_val_copy<uint64_t> key(height);
+  MDB_val result;
+  auto get_result = mdb_cursor_get(m_cur_block_filters, &key, &result, MDB_SET);
+  if (get_result == MDB_NOTFOUND)
+  {
+    TXN_POSTFIX_RDONLY();
+    return false;
+  }
+  else if (get_result)
+    throw0(DB_ERROR(lmdb_error("Error attempting to retrieve a block filter from the db: ", get_result).c_str()));
+
+  filter.assign(reinterpret_cast<char*>(result.mv_data), result.mv_size);
+
+  TXN_POSTFIX_RDONLY();
+  return true;
+}
+
 bool BlockchainLMDB::for_all_key_images(std::function<bool(const crypto::key_image&)> f) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -57,6 +57,8 @@ typedef struct mdb_txn_cursors
   MDB_cursor *m_txc_spent_keys;
 
   MDB_cursor *m_txc_hf_versions;
+
+  MDB_cursor *m_txc_block_filters;
 } mdb_txn_cursors;
 
 #define m_cur_blocks	m_cursors->m_txc_blocks
@@ -69,6 +71,7 @@ typedef struct mdb_txn_cursors
 #define m_cur_tx_outputs	m_cursors->m_txc_tx_outputs
 #define m_cur_spent_keys	m_cursors->m_txc_spent_keys
 #define m_cur_hf_versions	m_cursors->m_txc_hf_versions
+#define m_cur_block_filters	m_cursors->m_txc_block_filters
 
 typedef struct mdb_rflags
 {
@@ -83,6 +86,7 @@ typedef struct mdb_rflags
   bool m_rf_tx_outputs;
   bool m_rf_spent_keys;
   bool m_rf_hf_versions;
+  bool m_rf_block_filters;
 } mdb_rflags;
 
 typedef struct mdb_threadinfo
@@ -237,6 +241,8 @@ public:
 
   virtual bool has_key_image(const crypto::key_image& img) const;
 
+  virtual bool get_block_filter(const uint64_t& height, blobdata& filter) const;
+
   virtual bool for_all_key_images(std::function<bool(const crypto::key_image&)>) const;
   virtual bool for_all_blocks(std::function<bool(uint64_t, const crypto::hash&, const cryptonote::block&)>) const;
   virtual bool for_all_transactions(std::function<bool(const crypto::hash&, const cryptonote::transaction&)>) const;
@@ -292,6 +298,8 @@ private:
 
   virtual void remove_block();
 
+  virtual void add_block_filter(const blobdata& filter);
+
   virtual uint64_t add_transaction_data(const crypto::hash& blk_hash, const transaction& tx, const crypto::hash& tx_hash);
 
   virtual void remove_transaction_data(const crypto::hash& tx_hash, const transaction& tx);
@@ -370,6 +378,9 @@ private:
   MDB_dbi m_hf_starting_heights;
   MDB_dbi m_hf_versions;
 
+  MDB_dbi m_block_filters;
+  bool m_has_block_filters; // false if opened read-only on a db created before block filters
+
   MDB_dbi m_properties;
 
   uint64_t m_height;
@@ -30,6 +30,7 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "warnings.h"
@@ -67,6 +68,223 @@ uint64_t load_4(const unsigned char *in)
   return result;
 }
 
+#ifdef CRYPTO_OPS_FE51
+
+/* Field arithmetic with 5 limbs of 51 bits, h = h[0] + 2^51 h[1] + ... + 2^204 h[4].
+
+   Every function below leaves its result with limbs under 2^51 + 2^18 or so,
+   and accepts inputs with limbs under 2^52, so their results can be chained
+   without any carries in between. The products in fe_mul and fe_sq then fit
+   easily in 128 bits. */
+
+__extension__ typedef unsigned __int128 fe_uint128;
+
+#define FE51_MASK ((((uint64_t) 1) << 51) - 1)
+
+static uint64_t load_8(const unsigned char *in) {
+  return load_4(in) | (load_4(in + 4) << 32);
+}
+
+static void fe_carry(fe h) {
+  uint64_t c;
+  c = h[0] >> 51; h[0] &= FE51_MASK; h[1] += c;
+  c = h[1] >> 51; h[1] &= FE51_MASK; h[2] += c;
+  c = h[2] >> 51; h[2] &= FE51_MASK; h[3] += c;
+  c = h[3] >> 51; h[3] &= FE51_MASK; h[4] += c;
+  c = h[4] >> 51; h[4] &= FE51_MASK; h[0] += c * 19;
+}
+
+/*
+h = 0
+*/
+
+static void fe_0(fe h) {
+  h[0] = 0;
+  h[1] = 0;
+  h[2] = 0;
+  h[3] = 0;
+  h[4] = 0;
+}
+
+/*
+h = 1
+*/
+
+static void fe_1(fe h) {
+  h[0] = 1;
+  h[1] = 0;
+  h[2] = 0;
+  h[3] = 0;
+  h[4] = 0;
+}
+
+/*
+h = f + g
+Can overlap h with f or g.
+*/
+
+void fe_add(fe h, const fe f, const fe g) {
+  h[0] = f[0] + g[0];
+  h[1] = f[1] + g[1];
+  h[2] = f[2] + g[2];
+  h[3] = f[3] + g[3];
+  h[4] = f[4] + g[4];
+  fe_carry(h);
+}
+
+/*
+h = f - g
+Can overlap h with f or g.
+
+4 * p is added first so no limb goes negative.
+*/
+
+static void fe_sub(fe h, const fe f, const fe g) {
+  h[0] = f[0] + 0x1fffffffffffb4 - g[0];
+  h[1] = f[1] + 0x1ffffffffffffc - g[1];
+  h[2] = f[2] + 0x1ffffffffffffc - g[2];
+  h[3] = f[3] + 0x1ffffffffffffc - g[3];
+  h[4] = f[4] + 0x1ffffffffffffc - g[4];
+  fe_carry(h);
+}
+
+/*
+h = -f
+*/
+
+static void fe_neg(fe h, const fe f) {
+  fe zero;
+  fe_0(zero);
+  fe_sub(h, zero, f);
+}
+
+/*
+Replace (f,g) with (g,g) if b == 1;
+replace (f,g) with (f,g) if b == 0.
+
+Preconditions: b in {0,1}.
+*/
+
+static void fe_cmov(fe f, const fe g, unsigned int b) {
+  uint64_t mask = (uint64_t) 0 - (uint64_t) b;
+  f[0] ^= mask & (f[0] ^ g[0]);
+  f[1] ^= mask & (f[1] ^ g[1]);
+  f[2] ^= mask & (f[2] ^ g[2]);
+  f[3] ^= mask & (f[3] ^ g[3]);
+  f[4] ^= mask & (f[4] ^ g[4]);
+}
+
+/*
+h = f
+*/
+
+static void fe_copy(fe h, const fe f) {
+  h[0] = f[0];
+  h[1] = f[1];
+  h[2] = f[2];
+  h[3] = f[3];
+  h[4] = f[4];
+}
+
+/* Carries the 128-bit column sums of fe_mul and fe_sq into h */
+
+static void fe_carry_wide(fe h, fe_uint128 t0, fe_uint128 t1, fe_uint128 t2, fe_uint128 t3, fe_uint128 t4) {
+  uint64_t c;
+  h[0] = (uint64_t) t0 & FE51_MASK; t1 += (uint64_t) (t0 >> 51);
+  h[1] = (uint64_t) t1 & FE51_MASK; t2 += (uint64_t) (t1 >> 51);
+  h[2] = (uint64_t) t2 & FE51_MASK; t3 += (uint64_t) (t2 >> 51);
+  h[3] = (uint64_t) t3 & FE51_MASK; t4 += (uint64_t) (t3 >> 51);
+  h[4] = (uint64_t) t4 & FE51_MASK; c = (uint64_t) (t4 >> 51);
+  h[0] += c * 19;
+  c = h[0] >> 51; h[0] &= FE51_MASK; h[1] += c;
+}
+
+/*
+h = f * g
+Can overlap h with f or g.
+
+2^255 = 19 mod p, so the columns above 2^255 wrap around times 19.
+*/
+
+static void fe_mul(fe h, const fe f, const fe g) {
+  uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  uint64_t g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+  uint64_t g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4;
+  fe_uint128 t0, t1, t2, t3, t4;
+
+  t0 = (fe_uint128) f0 * g0 + (fe_uint128) f1 * g4_19 + (fe_uint128) f2 * g3_19 + (fe_uint128) f3 * g2_19 + (fe_uint128) f4 * g1_19;
+  t1 = (fe_uint128) f0 * g1 + (fe_uint128) f1 * g0 + (fe_uint128) f2 * g4_19 + (fe_uint128) f3 * g3_19 + (fe_uint128) f4 * g2_19;
+  t2 = (fe_uint128) f0 * g2 + (fe_uint128) f1 * g1 + (fe_uint128) f2 * g0 + (fe_uint128) f3 * g4_19 + (fe_uint128) f4 * g3_19;
+  t3 = (fe_uint128) f0 * g3 + (fe_uint128) f1 * g2 + (fe_uint128) f2 * g1 + (fe_uint128) f3 * g0 + (fe_uint128) f4 * g4_19;
+  t4 = (fe_uint128) f0 * g4 + (fe_uint128) f1 * g3 + (fe_uint128) f2 * g2 + (fe_uint128) f3 * g1 + (fe_uint128) f4 * g0;
+
+  fe_carry_wide(h, t0, t1, t2, t3, t4);
+}
+
+/*
+h = f * f
+Can overlap h with f.
+*/
+
+static void fe_sq(fe h, const fe f) {
+  uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  uint64_t f0_2 = 2 * f0, f1_2 = 2 * f1;
+  uint64_t f2_38 = 38 * f2, f3_19 = 19 * f3, f4_19 = 19 * f4, f4_38 = 38 * f4;
+  fe_uint128 t0, t1, t2, t3, t4;
+
+  t0 = (fe_uint128) f0 * f0 + (fe_uint128) f1 * f4_38 + (fe_uint128) f3 * f2_38;
+  t1 = (fe_uint128) f0_2 * f1 + (fe_uint128) f2 * f4_38 + (fe_uint128) f3 * f3_19;
+  t2 = (fe_uint128) f0_2 * f2 + (fe_uint128) f1 * f1 + (fe_uint128) f3 * f4_38;
+  t3 = (fe_uint128) f0_2 * f3 + (fe_uint128) f1_2 * f2 + (fe_uint128) f4 * f4_19;
+  t4 = (fe_uint128) f0_2 * f4 + (fe_uint128) f1_2 * f3 + (fe_uint128) f2 * f2;
+
+  fe_carry_wide(h, t0, t1, t2, t3, t4);
+}
+
+/*
+h = 2 * f * f
+Can overlap h with f.
+*/
+
+static void fe_sq2(fe h, const fe f) {
+  fe_sq(h, f);
+  fe_add(h, h, h);
+}
+
+/*
+Writes the canonical little-endian encoding of h, reduced below p.
+*/
+
+void fe_tobytes(unsigned char *s, const fe h) {
+  uint64_t t[5];
+  uint64_t c;
+  int i;
+
+  fe_copy(t, h);
+  fe_carry(t);
+  fe_carry(t);
+  /* now t is below 2^255 + 19 * 2 and its limbs below 2^51 but for t[0] */
+  /* add 19 so that the carry out of bit 255 is set exactly when t >= p */
+  c = (t[0] + 19) >> 51;
+  c = (t[1] + c) >> 51;
+  c = (t[2] + c) >> 51;
+  c = (t[3] + c) >> 51;
+  c = (t[4] + c) >> 51;
+  t[0] += 19 * c;
+  c = t[0] >> 51; t[0] &= FE51_MASK; t[1] += c;
+  c = t[1] >> 51; t[1] &= FE51_MASK; t[2] += c;
+  c = t[2] >> 51; t[2] &= FE51_MASK; t[3] += c;
+  c = t[3] >> 51; t[3] &= FE51_MASK; t[4] += c;
+  t[4] &= FE51_MASK;
+
+  for (i = 0; i < 8; ++i) s[i] = (unsigned char) ((t[0] | (t[1] << 51)) >> (8 * i));
+  for (i = 0; i < 8; ++i) s[8 + i] = (unsigned char) (((t[1] >> 13) | (t[2] << 38)) >> (8 * i));
+  for (i = 0; i < 8; ++i) s[16 + i] = (unsigned char) (((t[2] >> 26) | (t[3] << 25)) >> (8 * i));
+  for (i = 0; i < 8; ++i) s[24 + i] = (unsigned char) (((t[3] >> 39) | (t[4] << 12)) >> (8 * i));
+}
+
+#else
+
 /* From fe_0.c */
 
 /*
@@ -255,6 +473,8 @@ static void fe_copy(fe h, const fe f) {
   h[9] = f9;
 }
 
+#endif
+
 /* From fe_invert.c */
 
 void fe_invert(fe out, const fe z) {
@@ -342,6 +562,8 @@ static int fe_isnonzero(const fe f) {
     s[27] | s[28] | s[29] | s[30] | s[31]) - 1) >> 8) + 1;
 }
 
+#ifndef CRYPTO_OPS_FE51
+
 /* From fe_mul.c */
 
 /*
@@ -1122,6 +1344,8 @@ void fe_tobytes(unsigned char *s, const fe h) {
   s[31] = h9 >> 18;
 }
 
+#endif
+
 /* From ge_add.c */
 
 void ge_add(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q) {
@@ -1188,39 +1412,56 @@ void ge_dsm_precomp(ge_dsmp r, const ge_p3 *s) {
 }
 
 /*
-r = a * A + b * B
-where a = a[0]+256*a[1]+...+256^31 a[31].
-and b = b[0]+256*b[1]+...+256^31 b[31].
-B is the Ed25519 base point (x,4/5) with x positive.
+r = a[0] * A[0] + ... + a[n-1] * A[n-1] + b * B
+where Ai[j] = A[j], 3A[j], 5A[j], ..., 15A[j] as computed by ge_dsm_precomp
+and B is the Ed25519 base point (x,4/5) with x positive.
+The b * B term is left out if b is NULL, and all scalars must be reduced.
+slides is scratch space for 256 * n signed chars.
+
+Straus' method: the terms are interleaved, so they all share the same
+256 doublings, and each term only costs about 43 additions.
 */
 
-void ge_double_scalarmult_base_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b) {
-  signed char aslide[256];
+void ge_multiscalarmult_precomp_vartime(ge_p2 *r, size_t n, const unsigned char *const *a, const ge_cached *const *Ai, const unsigned char *b, signed char *slides) {
   signed char bslide[256];
-  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
   ge_p1p1 t;
   ge_p3 u;
+  size_t j;
   int i;
 
-  slide(aslide, a);
-  slide(bslide, b);
-  ge_dsm_precomp(Ai, A);
+  for (j = 0; j < n; ++j) {
+    slide(slides + 256 * j, a[j]);
+  }
+  if (b) {
+    slide(bslide, b);
+  } else {
+    for (i = 0; i < 256; ++i) {
+      bslide[i] = 0;
+    }
+  }
 
   ge_p2_0(r);
 
   for (i = 255; i >= 0; --i) {
-    if (aslide[i] || bslide[i]) break;
+    if (bslide[i]) break;
+    for (j = 0; j < n; ++j) {
+      if (slides[256 * j + i]) break;
+    }
+    if (j < n) break;
   }
 
   for (; i >= 0; --i) {
     ge_p2_dbl(&t, r);
 
-    if (aslide[i] > 0) {
-      ge_p1p1_to_p3(&u, &t);
-      ge_add(&t, &u, &Ai[aslide[i]/2]);
-    } else if (aslide[i] < 0) {
-      ge_p1p1_to_p3(&u, &t);
-      ge_sub(&t, &u, &Ai[(-aslide[i])/2]);
+    for (j = 0; j < n; ++j) {
+      signed char aslide = slides[256 * j + i];
+      if (aslide > 0) {
+        ge_p1p1_to_p3(&u, &t);
+        ge_add(&t, &u, &Ai[j][aslide/2]);
+      } else if (aslide < 0) {
+        ge_p1p1_to_p3(&u, &t);
+        ge_sub(&t, &u, &Ai[j][(-aslide)/2]);
+      }
     }
 
     if (bslide[i] > 0) {
@@ -1235,6 +1476,32 @@ void ge_double_scalarmult_base_vartime(ge_p2 *r, const unsigned char *a, const g
   }
 }
 
+/*
+r = a * A + b * B
+where a = a[0]+256*a[1]+...+256^31 a[31].
+and b = b[0]+256*b[1]+...+256^31 b[31].
+B is the Ed25519 base point (x,4/5) with x positive.
+*/
+
+void ge_double_scalarmult_base_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b) {
+  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
+
+  ge_dsm_precomp(Ai, A);
+  ge_double_scalarmult_base_precomp_vartime(r, a, Ai, b);
+}
+
+/*
+r = a * A + b * B
+where Ai = A, 3A, 5A, 7A, 9A, 11A, 13A, 15A as computed by ge_dsm_precomp
+and B is the Ed25519 base point (x,4/5) with x positive.
+*/
+
+void ge_double_scalarmult_base_precomp_vartime(ge_p2 *r, const unsigned char *a, const ge_dsmp Ai, const unsigned char *b) {
+  signed char aslide[256];
+
+  ge_multiscalarmult_precomp_vartime(r, 1, &a, &Ai, b, aslide);
+}
+
 /* From ge_frombytes.c, modified */
 
 int ge_frombytes_vartime(ge_p3 *h, const unsigned char *s) {
@@ -1245,6 +1512,24 @@ int ge_frombytes_vartime(ge_p3 *h, const unsigned char *s) {
 
   /* From fe_frombytes.c */
 
+#ifdef CRYPTO_OPS_FE51
+  uint64_t h0 = load_8(s) & FE51_MASK;
+  uint64_t h1 = (load_8(s + 6) >> 3) & FE51_MASK;
+  uint64_t h2 = (load_8(s + 12) >> 6) & FE51_MASK;
+  uint64_t h3 = (load_8(s + 19) >> 1) & FE51_MASK;
+  uint64_t h4 = (load_8(s + 24) >> 12) & FE51_MASK;
+
+  /* Validate the number to be canonical */
+  if (h4 == FE51_MASK && h3 == FE51_MASK && h2 == FE51_MASK && h1 == FE51_MASK && h0 >= FE51_MASK - 18) {
+    return -1;
+  }
+
+  h->Y[0] = h0;
+  h->Y[1] = h1;
+  h->Y[2] = h2;
+  h->Y[3] = h3;
+  h->Y[4] = h4;
+#else
   int64_t h0 = load_4(s);
   int64_t h1 = load_3(s + 4) << 6;
   int64_t h2 = load_3(s + 7) << 5;
@@ -1295,6 +1580,7 @@ int ge_frombytes_vartime(ge_p3 *h, const unsigned char *s) {
   h->Y[7] = h7;
   h->Y[8] = h8;
   h->Y[9] = h9;
+#endif
 
   /* End fe_frombytes.c */
 
@@ -1619,6 +1905,42 @@ void ge_tobytes(unsigned char *s, const ge_p2 *h) {
   s[31] ^= fe_isnegative(x) << 7;
 }
 
+/*
+Same as ge_tobytes for h[0], ..., h[n-1], into the 32 * n bytes at s.
+Montgomery's trick: the Z coordinates of up to 64 points are inverted
+together, with one field inversion and three multiplications each.
+*/
+
+void ge_tobytes_batch(unsigned char *s, const ge_p2 *h, size_t n) {
+  fe acc[64]; /* acc[i] = Z0 * Z1 * ... * Zi */
+  fe inv;
+  fe recip;
+  fe x;
+  fe y;
+  size_t i, k, m;
+
+  for (k = 0; k < n; k += m) {
+    m = n - k < 64 ? n - k : 64;
+    fe_copy(acc[0], h[k].Z);
+    for (i = 1; i < m; ++i) {
+      fe_mul(acc[i], acc[i - 1], h[k + i].Z);
+    }
+    fe_invert(inv, acc[m - 1]);
+    for (i = m; i-- > 0; ) {
+      if (i > 0) {
+        fe_mul(recip, inv, acc[i - 1]);
+        fe_mul(inv, inv, h[k + i].Z);
+      } else {
+        fe_copy(recip, inv);
+      }
+      fe_mul(x, h[k + i].X, recip);
+      fe_mul(y, h[k + i].Y, recip);
+      fe_tobytes(s + 32 * (k + i), y);
+      s[32 * (k + i) + 31] ^= fe_isnegative(x) << 7;
+    }
+  }
+}
+
 /* From sc_reduce.c */
 
 /*
@@ -2002,44 +2324,17 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
 }
 
 void ge_double_scalarmult_precomp_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b, const ge_dsmp Bi) {
-  signed char aslide[256];
-  signed char bslide[256];
   ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
-  ge_p1p1 t;
-  ge_p3 u;
-  int i;
+  const unsigned char *scalars[2];
+  const ge_cached *points[2];
+  signed char slides[2 * 256];
 
-  slide(aslide, a);
-  slide(bslide, b);
   ge_dsm_precomp(Ai, A);
-
-  ge_p2_0(r);
-
-  for (i = 255; i >= 0; --i) {
-    if (aslide[i] || bslide[i]) break;
-  }
-
-  for (; i >= 0; --i) {
-    ge_p2_dbl(&t, r);
-
-    if (aslide[i] > 0) {
-      ge_p1p1_to_p3(&u, &t);
-      ge_add(&t, &u, &Ai[aslide[i]/2]);
-    } else if (aslide[i] < 0) {
-      ge_p1p1_to_p3(&u, &t);
-      ge_sub(&t, &u, &Ai[(-aslide[i])/2]);
-    }
-
-    if (bslide[i] > 0) {
-      ge_p1p1_to_p3(&u, &t);
-      ge_add(&t, &u, &Bi[bslide[i]/2]);
-    } else if (bslide[i] < 0) {
-      ge_p1p1_to_p3(&u, &t);
-      ge_sub(&t, &u, &Bi[(-bslide[i])/2]);
-    }
-
-    ge_p1p1_to_p2(r, &t);
-  }
+  scalars[0] = a;
+  scalars[1] = b;
+  points[0] = Ai;
+  points[1] = Bi;
+  ge_multiscalarmult_precomp_vartime(r, 2, scalars, points, NULL, slides);
 }
 
 void ge_mul8(ge_p1p1 *r, const ge_p2 *t) {
@@ -2057,6 +2352,16 @@ void ge_fromfe_frombytes_vartime(ge_p2 *r, const unsigned char *s) {
 
   /* From fe_frombytes.c */
 
+#ifdef CRYPTO_OPS_FE51
+  /* unlike above, bit 255 is kept and reduced */
+  uint64_t h4 = load_8(s + 24) >> 12;
+
+  u[0] = (load_8(s) & FE51_MASK) + 19 * (h4 >> 51);
+  u[1] = (load_8(s + 6) >> 3) & FE51_MASK;
+  u[2] = (load_8(s + 12) >> 6) & FE51_MASK;
+  u[3] = (load_8(s + 19) >> 1) & FE51_MASK;
+  u[4] = h4 & FE51_MASK;
+#else
   int64_t h0 = load_4(s);
   int64_t h1 = load_3(s + 4) << 6;
   int64_t h2 = load_3(s + 7) << 5;
@@ -2100,6 +2405,7 @@ void ge_fromfe_frombytes_vartime(ge_p2 *r, const unsigned char *s) {
   u[7] = h7;
   u[8] = h8;
   u[9] = h9;
+#endif
 
   /* End fe_frombytes.c */
 
@@ -33,7 +33,15 @@
 
 /* From fe.h */
 
+/* Where the compiler has 128-bit integers, field elements are kept in
+   5 limbs of 51 bits, otherwise in the 10 limbs of 25.5 bits of ref10.
+   Define CRYPTO_OPS_FE25_5 to use the latter everywhere. */
+#if defined(__SIZEOF_INT128__) && !defined(CRYPTO_OPS_FE25_5)
+#define CRYPTO_OPS_FE51
+typedef uint64_t fe[5];
+#else
 typedef int32_t fe[10];
+#endif
 
 /* From ge.h */
 
@@ -80,6 +88,8 @@ typedef ge_cached ge_dsmp[8];
 extern const ge_precomp ge_Bi[8];
 void ge_dsm_precomp(ge_dsmp r, const ge_p3 *s);
 void ge_double_scalarmult_base_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *);
+void ge_double_scalarmult_base_precomp_vartime(ge_p2 *, const unsigned char *, const ge_dsmp, const unsigned char *);
+void ge_multiscalarmult_precomp_vartime(ge_p2 *, size_t, const unsigned char *const *, const ge_cached *const *, const unsigned char *, signed char *);
 
 /* From ge_frombytes.c, modified */
 
@@ -120,6 +130,7 @@ void ge_scalarmult_base(ge_p3 *, const unsigned char *);
 /* From ge_tobytes.c */
 
 void ge_tobytes(unsigned char *, const ge_p2 *);
+void ge_tobytes_batch(unsigned char *, const ge_p2 *, size_t);
 
 /* From sc_reduce.c */
 
@@ -34,6 +34,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <vector>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
 
@@ -41,6 +42,7 @@
 #include "warnings.h"
 #include "crypto.h"
 #include "hash.h"
+#include "point_cache.h"
 
 #if !defined(__FreeBSD__) && !defined(__OpenBSD__) && !defined(__DragonFly__)
 #include <alloca.h>
@@ -543,22 +545,25 @@ namespace crypto {
     ge_dsm_precomp(image_pre, &image_unp);
     sc_0(&sum);
     buf->h = prefix_hash;
+    // all the a and b are only needed encoded, in a row, so they are encoded together
+    std::vector<ge_p2> ab(2 * pubs_count);
     for (i = 0; i < pubs_count; i++) {
-      ge_p2 tmp2;
       ge_p3 tmp3;
       if (sc_check(&sig[i].c) != 0 || sc_check(&sig[i].r) != 0) {
         return false;
       }
-      if (ge_frombytes_vartime(&tmp3, &*pubs[i]) != 0) {
+      // ring members are reused as decoys, so their precomputations are cached
+      ge_dsmp pub_pre;
+      if (!dsm_precomp_cached(pub_pre, &*pubs[i])) {
         return false;
       }
-      ge_double_scalarmult_base_vartime(&tmp2, &sig[i].c, &tmp3, &sig[i].r);
-      ge_tobytes(&buf->ab[i].a, &tmp2);
+      ge_double_scalarmult_base_precomp_vartime(&ab[2 * i], &sig[i].c, pub_pre, &sig[i].r);
       hash_to_ec(*pubs[i], tmp3);
-      ge_double_scalarmult_precomp_vartime(&tmp2, &sig[i].r, &tmp3, &sig[i].c, image_pre);
-      ge_tobytes(&buf->ab[i].b, &tmp2);
+      ge_double_scalarmult_precomp_vartime(&ab[2 * i + 1], &sig[i].r, &tmp3, &sig[i].c, image_pre);
       sc_add(&sum, &sum, &sig[i].c);
     }
+    static_assert(sizeof(buf->ab[0]) == 2 * sizeof(ec_point), "ec_point_pair must be two packed points");
+    ge_tobytes_batch(reinterpret_cast<unsigned char *>(buf->ab), ab.data(), ab.size());
     hash_to_scalar(buf, rs_comm_size(pubs_count), h);
     sc_sub(&h, &h, &sum);
     return sc_isnonzero(&h) == 0;
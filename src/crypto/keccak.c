@@ -110,3 +110,56 @@ void keccak1600(const uint8_t *in, size_t inlen, uint8_t *md)
 {
     keccak(in, inlen, md, sizeof(state_t));
 }
+
+static void keccak_absorb(uint64_t st[25], const uint8_t *block)
+{
+    size_t i;
+
+    for (i = 0; i < KECCAK_WORDS; i++)
+        st[i] ^= ((const uint64_t *) block)[i];
+    keccakf(st, KECCAK_ROUNDS);
+}
+
+void keccak_init(KECCAK_CTX *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void keccak_update(KECCAK_CTX *ctx, const uint8_t *in, size_t inlen)
+{
+    uint8_t *message = (uint8_t *) ctx->message;
+
+    // top up a partial block first
+    if (ctx->rest) {
+        size_t left = KECCAK_BLOCKLEN - ctx->rest;
+        if (left > inlen)
+            left = inlen;
+        memcpy(message + ctx->rest, in, left);
+        ctx->rest += left;
+        in += left;
+        inlen -= left;
+        if (ctx->rest < KECCAK_BLOCKLEN)
+            return;
+        keccak_absorb(ctx->hash, message);
+        ctx->rest = 0;
+    }
+
+    for ( ; inlen >= KECCAK_BLOCKLEN; inlen -= KECCAK_BLOCKLEN, in += KECCAK_BLOCKLEN)
+        keccak_absorb(ctx->hash, in);
+
+    memcpy(message, in, inlen);
+    ctx->rest = inlen;
+}
+
+void keccak_finish(KECCAK_CTX *ctx, uint8_t *md, int mdlen)
+{
+    uint8_t *message = (uint8_t *) ctx->message;
+
+    // last block and padding
+    memset(message + ctx->rest, 0, KECCAK_BLOCKLEN - ctx->rest);
+    message[ctx->rest] |= 1;
+    message[KECCAK_BLOCKLEN - 1] |= 0x80;
+    keccak_absorb(ctx->hash, message);
+
+    memcpy(md, ctx->hash, mdlen);
+}
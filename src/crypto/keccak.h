@@ -19,9 +19,28 @@ extern "C" {
 #define ROTL64(x, y) (((x) << (y)) | ((x) >> (64 - (y))))
 #endif
 
+// SHA3 Algorithm context, for hashing a message given in pieces
+#define KECCAK_BLOCKLEN 136
+#define KECCAK_WORDS 17
+
+typedef struct KECCAK_CTX
+{
+  // 1600 bits algorithm hashing state
+  uint64_t hash[25];
+  // 1088-bit buffer for leftovers
+  uint64_t message[KECCAK_WORDS];
+  // count of bytes in the message[] buffer
+  size_t rest;
+} KECCAK_CTX;
+
 // compute a keccak hash (md) of given byte length from "in"
 int keccak(const uint8_t *in, size_t inlen, uint8_t *md, int mdlen);
 
+// the same as keccak1600 (truncated to mdlen bytes), one piece at a time
+void keccak_init(KECCAK_CTX *ctx);
+void keccak_update(KECCAK_CTX *ctx, const uint8_t *in, size_t inlen);
+void keccak_finish(KECCAK_CTX *ctx, uint8_t *md, int mdlen);
+
 // update the state
 void keccakf(uint64_t st[25], int norounds);
 
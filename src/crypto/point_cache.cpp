@@ -0,0 +1,180 @@
+// Copyright (c) 2017-2018, The Bixbite Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+#include "point_cache.h"
+#include "crypto.h"
+
+namespace crypto {
+
+  namespace {
+
+    // about 1.5 kB per point with its precomputation, so 12 MB in all
+    const size_t POINT_CACHE_SHARDS = 16;
+    const size_t POINT_CACHE_SHARD_ENTRIES = 512;
+
+    struct cached_point
+    {
+      public_key key;
+      ge_p3 point;
+      ge_dsmp precomp;
+      bool has_precomp;
+    };
+
+    // The cache is split in independent LRU lists by key, so threads checking
+    // different transactions seldom wait on each other
+    class point_cache_shard
+    {
+    public:
+      // copies the point out, and its precomputation too if precomp is not null and there is one
+      bool find(const public_key &key, ge_p3 &point, ge_cached *precomp, bool &has_precomp)
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        std::unordered_map<public_key, std::list<cached_point>::iterator>::const_iterator i = m_index.find(key);
+        if (i == m_index.end())
+          return false;
+        m_points.splice(m_points.begin(), m_points, i->second);
+        const cached_point &p = *i->second;
+        point = p.point;
+        has_precomp = p.has_precomp;
+        if (precomp && has_precomp)
+          memcpy(precomp, p.precomp, sizeof(p.precomp));
+        return true;
+      }
+
+      void insert(const public_key &key, const ge_p3 &point, const ge_cached *precomp)
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        std::unordered_map<public_key, std::list<cached_point>::iterator>::iterator i = m_index.find(key);
+        if (i != m_index.end())
+        {
+          // another thread got there first, or the precomputation is being added
+          m_points.splice(m_points.begin(), m_points, i->second);
+        }
+        else
+        {
+          m_points.emplace_front();
+          m_points.front().key = key;
+          m_points.front().point = point;
+          m_points.front().has_precomp = false;
+          m_index.emplace(key, m_points.begin());
+          if (m_points.size() > POINT_CACHE_SHARD_ENTRIES)
+          {
+            m_index.erase(m_points.back().key);
+            m_points.pop_back();
+          }
+        }
+        if (precomp && !m_points.front().has_precomp)
+        {
+          memcpy(m_points.front().precomp, precomp, sizeof(ge_dsmp));
+          m_points.front().has_precomp = true;
+        }
+      }
+
+      size_t size()
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        return m_points.size();
+      }
+
+    private:
+      boost::mutex m_mutex;
+      std::list<cached_point> m_points; // most recently used first
+      std::unordered_map<public_key, std::list<cached_point>::iterator> m_index;
+    };
+
+    point_cache_shard shards[POINT_CACHE_SHARDS];
+    std::atomic<uint64_t> hits(0);
+    std::atomic<uint64_t> misses(0);
+
+    point_cache_shard &get_shard(const public_key &key)
+    {
+      return shards[(unsigned char)key.data[0] % POINT_CACHE_SHARDS];
+    }
+  }
+
+  bool frombytes_cached(ge_p3 &point, const unsigned char *bytes)
+  {
+    public_key key;
+    memcpy(&key, bytes, sizeof(key));
+    point_cache_shard &shard = get_shard(key);
+    bool has_precomp;
+    if (shard.find(key, point, NULL, has_precomp))
+    {
+      ++hits;
+      return true;
+    }
+    ++misses;
+    if (ge_frombytes_vartime(&point, bytes) != 0)
+      return false;
+    shard.insert(key, point, NULL);
+    return true;
+  }
+
+  bool dsm_precomp_cached(ge_dsmp precomp, const unsigned char *bytes)
+  {
+    public_key key;
+    memcpy(&key, bytes, sizeof(key));
+    point_cache_shard &shard = get_shard(key);
+    ge_p3 point;
+    bool has_precomp = false;
+    if (shard.find(key, point, precomp, has_precomp))
+    {
+      ++hits;
+      if (has_precomp)
+        return true;
+    }
+    else
+    {
+      ++misses;
+      if (ge_frombytes_vartime(&point, bytes) != 0)
+        return false;
+    }
+    ge_dsm_precomp(precomp, &point);
+    shard.insert(key, point, precomp);
+    return true;
+  }
+
+  point_cache_stats get_point_cache_stats()
+  {
+    point_cache_stats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.entries = 0;
+    for (size_t i = 0; i < POINT_CACHE_SHARDS; ++i)
+      stats.entries += shards[i].size();
+    return stats;
+  }
+
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2017-2018, The Bixbite Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+#include "crypto-ops.h"
+}
+
+namespace crypto {
+
+  /**
+   * @brief counters of the decompressed point cache
+   */
+  struct point_cache_stats
+  {
+    uint64_t hits;
+    uint64_t misses;
+    size_t entries;
+  };
+
+  /**
+   * @brief decompresses a point, going through the point cache
+   *
+   * Ring members are picked as decoys by many transactions, so the same keys
+   * and commitments get decompressed over and over again when verifying. The
+   * most recently used ones are kept decompressed, up to a fixed number of
+   * entries. Encodings which are not valid points are not cached.
+   *
+   * @param point return-by-reference the decompressed point
+   * @param bytes the 32 byte encoding of the point
+   *
+   * @return true if the encoding is a valid point, otherwise false
+   */
+  bool frombytes_cached(ge_p3 &point, const unsigned char *bytes);
+
+  /**
+   * @brief gets the ge_dsm_precomp precomputation of a point, going through the point cache
+   *
+   * @param precomp return-by-reference the precomputation
+   * @param bytes the 32 byte encoding of the point
+   *
+   * @return true if the encoding is a valid point, otherwise false
+   */
+  bool dsm_precomp_cached(ge_dsmp precomp, const unsigned char *bytes);
+
+  /**
+   * @brief gets the hit/miss counters of the point cache since startup
+   *
+   * @return the counters and the number of points currently cached
+   */
+  point_cache_stats get_point_cache_stats();
+
+}
@@ -86,10 +86,21 @@
 #define BLOCKS_SYNCHRONIZING_DEFAULT_COUNT              100    //by default, blocks count in blocks downloading
 #define CRYPTONOTE_PROTOCOL_HOP_RELAX_COUNT             3      //value of hop, after which we use only announce of new block
 
+#define BLOCK_QUEUE_MAX_SIZE                            (100 * 1024 * 1024) //bytes of downloaded blocks waiting to be added, before we only fetch the next needed span
+#define BLOCK_QUEUE_SPAN_STEAL_TIME                     10     //seconds a span may be pending with a slow peer before a faster one takes it over
+
+#define CRYPTONOTE_PROTOCOL_TX_TRICKLE_INTERVAL         5      //average seconds between batches of relayed txs sent to a peer
+#define CRYPTONOTE_PROTOCOL_MAX_KNOWN_TXS               100000 //txs remembered per peer as already known to it
+
 #define CRYPTONOTE_MEMPOOL_TX_LIVETIME                  86400 //seconds, one day
 #define CRYPTONOTE_MEMPOOL_TX_FROM_ALT_BLOCK_LIVETIME   604800 //seconds, one week
 
 #define COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT           250
+#define COMMAND_RPC_GET_BLOCKS_FAST_MAX_SIZE            (10 * 1024 * 1024) // bytes
+#define COMMAND_RPC_SCAN_OUTPUTS_MAX_COUNT              1000
+#define COMMAND_RPC_SCAN_OUTPUTS_MAX_SUBADDRESSES       10000
+#define COMMAND_RPC_GET_BLOCK_FILTERS_MAX_COUNT         10000
+#define COMMAND_RPC_ARE_KEY_IMAGES_SPENT_MAX_COUNT      100000
 
 #define P2P_LOCAL_WHITE_PEERLIST_LIMIT                  1000
 #define P2P_LOCAL_GRAY_PEERLIST_LIMIT                   5000
@@ -119,6 +130,7 @@
 #define CRYPTONOTE_BLOCKCHAINDATA_FILENAME              "blockchain.bin"
 #define CRYPTONOTE_BLOCKCHAINDATA_TEMP_FILENAME         "blockchain.bin.tmp"
 #define P2P_NET_DATA_FILENAME                           "p2pstate.bin"
+#define P2P_NET_JOURNAL_FILENAME                        "p2pstate.journal"
 #define MINER_CONFIG_FILE_NAME                          "miner_conf.json"
 
 #define THREAD_STACK_SIZE                               5 * 1024 * 1024
@@ -52,10 +52,12 @@
 #include "common/boost_serialization_helper.h"
 #include "warnings.h"
 #include "crypto/hash.h"
+#include "crypto/point_cache.h"
 #include "cryptonote_core/checkpoints.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "ringct/rctSigs.h"
 #include "common/perf_timer.h"
+#include "common/threadpool.h"
 #if defined(PER_BLOCK_CHECKPOINT)
 #include "blocks/blocks.h"
 #endif
@@ -77,6 +79,9 @@ DISABLE_VS_WARNINGS(4267)
 #define BLOCK_REWARD_OVERESTIMATE   ((uint64_t)(16000000000))
 #define MAINNET_HARDFORK_V3_HEIGHT  ((uint64_t)(1))
 
+// below twice this many key images, a spent check is not worth splitting up
+#define KEY_IMAGES_SPENT_CHECK_BATCH_SIZE 1000
+
 static const struct {
     uint8_t version;
     uint64_t height;
@@ -127,6 +132,41 @@ bool Blockchain::have_tx_keyimg_as_spent(const crypto::key_image &key_im) const
     return  m_db->has_key_image(key_im);
 }
 //------------------------------------------------------------------
+bool Blockchain::have_tx_keyimgs_as_spent(const std::vector<crypto::key_image> &key_images, std::vector<bool> &spent) const
+{
+    LOG_PRINT_L3("Blockchain::" << __func__);
+    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+    // std::vector<bool> packs bits, so workers write to bytes instead
+    std::vector<uint8_t> found(key_images.size(), 0);
+    auto check = [this, &key_images, &found](size_t begin, size_t end) {
+        m_db->block_txn_start(true);
+        for (size_t i = begin; i < end; ++i)
+            found[i] = m_db->has_key_image(key_images[i]);
+        m_db->block_txn_stop();
+    };
+
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    const size_t threads = std::max<size_t>(1, tpool.get_max_concurrency());
+    if (threads == 1 || key_images.size() < 2 * KEY_IMAGES_SPENT_CHECK_BATCH_SIZE)
+    {
+        check(0, key_images.size());
+    }
+    else
+    {
+        // the blockchain lock keeps writers out, so every worker's read txn
+        // sees the same chain
+        const size_t batch = std::max<size_t>(KEY_IMAGES_SPENT_CHECK_BATCH_SIZE, (key_images.size() + threads - 1) / threads);
+        tools::threadpool::waiter waiter;
+        for (size_t begin = 0; begin < key_images.size(); begin += batch)
+            tpool.submit(&waiter, std::bind(check, begin, std::min(begin + batch, key_images.size())));
+        waiter.wait();
+    }
+
+    spent.assign(found.begin(), found.end());
+    return true;
+}
+//------------------------------------------------------------------
 // This function makes sure that each "input" in an input (mixins) exists
 // and collects the public key for each from the transaction it was included in
 // via the visitor passed to it.
@@ -1973,7 +2013,7 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qbloc
 // find split point between ours and foreign blockchain (or start at
 // blockchain height <req_start_block>), and return up to max_count FULL
 // blocks by reference.
-bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count) const
+bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count, size_t max_size) const
 {
     LOG_PRINT_L3("Blockchain::" << __func__);
     CRITICAL_REGION_LOCAL(m_blockchain_lock);
@@ -1997,9 +2037,15 @@ bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, cons
     }
 
     total_height = get_current_blockchain_height();
-    size_t count = 0;
+    size_t count = 0, size = 0;
     for(size_t i = start_height; i < total_height && count < max_count; i++, count++)
     {
+        // the stored block size covers the miner tx and every other tx, which
+        // make up the bulk of what the caller will send back
+        const size_t block_size = m_db->get_block_size(i);
+        if (count > 0 && size + block_size > max_size)
+            break;
+        size += block_size;
         blocks.resize(blocks.size()+1);
         blocks.back().first = m_db->get_block_from_height(i);
         std::list<crypto::hash> mis;
@@ -3251,6 +3297,10 @@ leave:
                      << target_calculating_time << "/" << longhash_calculating_time << "/"
                      << t1 << "/" << t2 << "/" << t3 << "/" << t_exists << "/" << t_pool
                      << "/" << t_checktx << "/" << t_dblspnd << "/" << vmt << "/" << addblock << ")ms");
+        const crypto::point_cache_stats pcs = crypto::get_point_cache_stats();
+        const uint64_t lookups = pcs.hits + pcs.misses;
+        LOG_PRINT_L0("Point cache: " << pcs.entries << " points, " << pcs.hits << "/" << lookups << " lookups hit ("
+                     << (lookups ? pcs.hits * 100 / lookups : 0) << "%)");
     }
 
     bvc.m_added_to_main_chain = true;
@@ -3576,6 +3626,59 @@ void Blockchain::block_longhash_worker(cn_pow_hash_v2& hash_ctx, const std::vect
     TIME_MEASURE_FINISH(t);
 }
 
+//------------------------------------------------------------------
+void Blockchain::precompute_block_longhashes(uint64_t start_height, const std::list<block_complete_entry> &blocks_entry)
+{
+    LOG_PRINT_YELLOW("Blockchain::" << __func__, LOG_LEVEL_3);
+
+    // checked against the compiled in block hashes instead
+    if (start_height + blocks_entry.size() < m_blocks_hash_check.size())
+        return;
+
+    TIME_MEASURE_START(t);
+    uint64_t threads = std::max<uint64_t>(std::min<uint64_t>(tools::get_max_concurrency(), m_max_prepare_blocks_threads), 1);
+    std::vector<std::vector<block>> thread_blocks(threads);
+    std::unordered_map<crypto::hash, uint64_t> heights;
+    uint64_t height = start_height;
+    for (const auto &entry : blocks_entry)
+    {
+        block b;
+        if (!parse_and_validate_block_from_blob(entry.block, b))
+            break;
+        heights.emplace(get_block_hash(b), height);
+        thread_blocks[(height - start_height) % threads].push_back(std::move(b));
+        ++height;
+    }
+
+    if (m_precompute_hash_ctxes.size() < threads)
+        m_precompute_hash_ctxes.resize(threads);
+
+    std::vector<std::unordered_map<crypto::hash, crypto::hash>> maps(threads);
+    std::vector<boost::thread *> thread_list;
+    for (uint64_t i = 0; i < threads; i++)
+    {
+        if (!thread_blocks[i].empty())
+            thread_list.push_back(new boost::thread(&Blockchain::block_longhash_worker, this, std::ref(m_precompute_hash_ctxes[i]), std::cref(thread_blocks[i]), std::ref(maps[i])));
+    }
+    for (size_t j = 0; j < thread_list.size(); j++)
+    {
+        thread_list[j]->join();
+        delete thread_list[j];
+    }
+
+    if (m_cancel)
+        return;
+
+    CRITICAL_REGION_LOCAL(m_precomputed_longhashes_lock);
+    for (const auto &map : maps)
+    {
+        for (const auto &pow : map)
+            m_precomputed_longhashes[pow.first] = std::make_pair(heights[pow.first], pow.second);
+    }
+    TIME_MEASURE_FINISH(t);
+    LOG_PRINT_L2("Precomputed proof of work for " << heights.size() << " blocks from height " << start_height << " in " << t << " ms");
+}
+
 //------------------------------------------------------------------
 bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
 {
@@ -3643,22 +3746,59 @@ void Blockchain::output_scan_worker(const uint64_t amount, const std::vector<uin
 //    vs [k_image, output_keys] (m_scan_table). This is faster because it takes advantage of bulk queries
 //    and is threaded if possible. The table (m_scan_table) will be used later when querying output
 //    keys.
-bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_entry> &blocks_entry)
+bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_entry> &blocks_entry, std::vector<block> &blocks)
 {
     LOG_PRINT_YELLOW("Blockchain::" << __func__, LOG_LEVEL_3);
     TIME_MEASURE_START(prepare);
     CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
+    blocks.clear();
     if(blocks_entry.size() == 0)
         return false;
 
+    blocks.reserve(blocks_entry.size());
+    for (const auto &entry : blocks_entry)
+    {
+        block block;
+        if (!parse_and_validate_block_from_blob(entry.block, block))
+        {
+            LOG_PRINT_L1("Failed to parse incoming block");
+            break;
+        }
+        blocks.push_back(std::move(block));
+    }
+
     if ((m_db->height() + blocks_entry.size()) < m_blocks_hash_check.size())
         return true;
 
+    // proof of work already computed while these blocks were queued
+    std::unordered_map<crypto::hash, crypto::hash> precomputed;
+    {
+        CRITICAL_REGION_LOCAL(m_precomputed_longhashes_lock);
+        const uint64_t height = m_db->height();
+        for (auto i = m_precomputed_longhashes.begin(); i != m_precomputed_longhashes.end(); )
+        {
+            // left over from blocks which came in another way
+            if (i->second.first < height)
+                i = m_precomputed_longhashes.erase(i);
+            else
+                ++i;
+        }
+        for (const auto &block : blocks)
+        {
+            auto i = m_precomputed_longhashes.find(get_block_hash(block));
+            if (i != m_precomputed_longhashes.end())
+            {
+                precomputed.emplace(i->first, i->second.second);
+                m_precomputed_longhashes.erase(i);
+            }
+        }
+    }
+
     bool blocks_exist = false;
     uint64_t threads = tools::get_max_concurrency();
 
-    if (blocks_entry.size() > 1 && threads > 1 && m_max_prepare_blocks_threads > 1)
+    if (blocks.size() > 1 && threads > 1 && m_max_prepare_blocks_threads > 1)
     {
         // limit threads, default limit = 4
         if(threads > m_max_prepare_blocks_threads)
@@ -3666,24 +3806,18 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
 
         uint64_t height = m_db->height();
         std::vector<boost::thread *> thread_list;
-        int batches = blocks_entry.size() / threads;
-        int extra = blocks_entry.size() % threads;
+        int batches = blocks.size() / threads;
+        int extra = blocks.size() % threads;
         LOG_PRINT_L1("block_batches: " << batches);
         std::vector<std::unordered_map<crypto::hash, crypto::hash>> maps(threads);
-        std::vector < std::vector < block >> blocks(threads);
-        auto it = blocks_entry.begin();
+        std::vector < std::vector < block >> thread_blocks(threads);
+        auto it = blocks.begin();
 
         for (uint64_t i = 0; i < threads; i++)
         {
             for (int j = 0; j < batches; j++)
             {
-                block block;
-
-                if (!parse_and_validate_block_from_blob(it->block, block))
-                {
-                    std::advance(it, 1);
-                    continue;
-                }
+                const block &block = *it;
 
                 // check first block and skip all blocks if its not chained properly
                 if (i == 0 && j == 0)
@@ -3695,34 +3829,32 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
                         return true;
                     }
                 }
-                if (have_block(get_block_hash(block)))
+                const crypto::hash id = get_block_hash(block);
+                if (have_block(id))
                 {
                     blocks_exist = true;
                     break;
                 }
 
-                blocks[i].push_back(block);
+                if (!precomputed.count(id))
+                    thread_blocks[i].push_back(block);
                 std::advance(it, 1);
             }
         }
 
         for (int i = 0; i < extra && !blocks_exist; i++)
         {
-            block block;
-
-            if (!parse_and_validate_block_from_blob(it->block, block))
-            {
-                std::advance(it, 1);
-                continue;
-            }
+            const block &block = *it;
 
-            if (have_block(get_block_hash(block)))
+            const crypto::hash id = get_block_hash(block);
+            if (have_block(id))
             {
                 blocks_exist = true;
                 break;
             }
 
-            blocks[i].push_back(block);
+            if (!precomputed.count(id))
+                thread_blocks[i].push_back(block);
             std::advance(it, 1);
         }
 
@@ -3735,7 +3867,8 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
 
             for (uint64_t i = 0; i < threads; i++)
             {
-                thread_list.push_back(new boost::thread(&Blockchain::block_longhash_worker, this, std::ref(m_hash_ctxes_multi[i]), std::cref(blocks[i]), std::ref(maps[i])));
+                if (!thread_blocks[i].empty())
+                    thread_list.push_back(new boost::thread(&Blockchain::block_longhash_worker, this, std::ref(m_hash_ctxes_multi[i]), std::cref(thread_blocks[i]), std::ref(maps[i])));
             }
 
             for (size_t j = 0; j < thread_list.size(); j++)
@@ -3755,6 +3888,8 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
             }
         }
     }
+    if (!blocks_exist)
+        m_blocks_longhash_table.insert(precomputed.begin(), precomputed.end());
 
     if (m_cancel)
         return false;
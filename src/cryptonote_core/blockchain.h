@@ -216,11 +216,30 @@ namespace cryptonote
     /**
      * @brief performs some preprocessing on a group of incoming blocks to speed up verification
      *
-     * @param blocks a list of incoming blocks
+     * The blocks are parsed once here, and handed back so they do not need
+     * to be parsed again when they are added.
+     *
+     * @param blocks_entry a list of incoming blocks
+     * @param blocks return-by-reference the parsed blocks, in order, stopping
+     *        before the first block which fails to parse
      *
      * @return false on erroneous blocks, else true
      */
-    bool prepare_handle_incoming_blocks(const std::list<block_complete_entry>  &blocks);
+    bool prepare_handle_incoming_blocks(const std::list<block_complete_entry> &blocks_entry, std::vector<block> &blocks);
+
+    /**
+     * @brief computes the proof of work of blocks which cannot be added yet
+     *
+     * Used for blocks downloaded ahead of the chain, while waiting for the
+     * ones before them. The hashes are kept until the blocks go through
+     * prepare_handle_incoming_blocks, so adding them does not need to wait
+     * for the proof of work. Uses up to max_prepare_blocks_threads threads,
+     * and must not be called from more than one thread at a time.
+     *
+     * @param start_height the height of the first block
+     * @param blocks_entry the blocks
+     */
+    void precompute_block_longhashes(uint64_t start_height, const std::list<block_complete_entry> &blocks_entry);
 
     /**
      * @brief incoming blocks post-processing, cleanup, and disk sync
@@ -265,6 +284,19 @@ namespace cryptonote
      */
     bool have_tx_keyimg_as_spent(const crypto::key_image &key_im) const;
 
+    /**
+     * @brief check which of a set of key images are spent on the blockchain
+     *
+     * All lookups are made against the same state of the chain. Large sets
+     * are split across the thread pool, each worker using its own read txn.
+     *
+     * @param key_images the key images to search for
+     * @param spent return-by-reference whether each key image is spent
+     *
+     * @return true
+     */
+    bool have_tx_keyimgs_as_spent(const std::vector<crypto::key_image> &key_images, std::vector<bool> &spent) const;
+
     /**
      * @brief get the current height of the blockchain
      *
@@ -414,10 +446,12 @@ namespace cryptonote
      * @param total_height return-by-reference our current blockchain height
      * @param start_height return-by-reference the height of the first block returned
      * @param max_count the max number of blocks to get
+     * @param max_size the max cumulative size of the blocks to get, in bytes;
+     *        at least one block is returned if any are available
      *
      * @return true if a block found in common or req_start_block specified, else false
      */
-    bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count) const;
+    bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count, size_t max_size) const;
 
     /**
      * @brief retrieves a set of blocks and their transactions, and possibly other transactions
@@ -887,6 +921,10 @@ namespace cryptonote
     // metadata containers
     std::unordered_map<crypto::hash, std::unordered_map<crypto::key_image, std::vector<output_data_t>>> m_scan_table;
     std::unordered_map<crypto::hash, crypto::hash> m_blocks_longhash_table;
+
+    // proof of work computed ahead by precompute_block_longhashes, with the block's height
+    std::unordered_map<crypto::hash, std::pair<uint64_t, crypto::hash>> m_precomputed_longhashes;
+    epee::critical_section m_precomputed_longhashes_lock;
     std::unordered_map<crypto::hash, std::unordered_map<crypto::key_image, bool>> m_check_txin_table;
 
     // SHA-3 hashes for each block and for fast pow checking
@@ -917,6 +955,7 @@ namespace cryptonote
 
 	cn_pow_hash_v2 m_pow_ctx;
 	std::vector<cn_pow_hash_v2> m_hash_ctxes_multi;
+	std::vector<cn_pow_hash_v2> m_precompute_hash_ctxes;
 
     checkpoints m_checkpoints;
     std::atomic<bool> m_is_in_checkpoint_zone;
@@ -251,6 +251,32 @@ namespace cryptonote
       }
     END_SERIALIZE()
 
+    /*! \brief serializes the prefix and, for RingCT txes, the non prunable
+     *  part of the signatures (type, fee, ecdhInfo, outPk)
+     *
+     *  This is all a wallet needs to scan a tx: v1 signatures and RingCT
+     *  range proofs and MLSAGs are left out. Loading a full tx blob this way
+     *  also works, the prunable data is then simply not read.
+     */
+    template<bool W, template <bool> class Archive>
+    bool serialize_base(Archive<W> &ar)
+    {
+      FIELDS(*static_cast<transaction_prefix *>(this))
+
+      if (version > 1)
+      {
+        ar.tag("rct_signatures");
+        if (!vin.empty())
+        {
+          ar.begin_object();
+          bool r = rct_signatures.serialize_rctsig_base(ar, vin.size(), vout.size());
+          if (!r || !ar.stream().good()) return false;
+          ar.end_object();
+        }
+      }
+      return true;
+    }
+
   private:
     static size_t get_signature_size(const txin_v& tx_in);
   };
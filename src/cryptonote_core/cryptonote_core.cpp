@@ -480,6 +480,12 @@ namespace cryptonote
     }
     //-----------------------------------------------------------------------------------------------
     bool core::handle_incoming_tx(const blobdata& tx_blob, tx_verification_context& tvc, bool keeped_by_block, bool relayed)
+    {
+        crypto::hash tx_hash;
+        return handle_incoming_tx(tx_blob, tvc, keeped_by_block, relayed, tx_hash);
+    }
+    //-----------------------------------------------------------------------------------------------
+    bool core::handle_incoming_tx(const blobdata& tx_blob, tx_verification_context& tvc, bool keeped_by_block, bool relayed, crypto::hash& tx_hash)
     {
         tvc = boost::value_initialized<tx_verification_context>();
         //want to process all transactions sequentially
@@ -493,7 +499,7 @@ namespace cryptonote
             return false;
         }
 
-        crypto::hash tx_hash = null_hash;
+        tx_hash = null_hash;
         crypto::hash tx_prefixt_hash = null_hash;
         transaction tx;
 
@@ -628,12 +634,12 @@ namespace cryptonote
     //-----------------------------------------------------------------------------------------------
     bool core::are_key_images_spent(const std::vector<crypto::key_image>& key_im, std::vector<bool> &spent) const
     {
-        spent.clear();
-        BOOST_FOREACH(auto& ki, key_im)
-        {
-            spent.push_back(m_blockchain_storage.have_tx_keyimg_as_spent(ki));
-        }
-        return true;
+        return m_blockchain_storage.have_tx_keyimgs_as_spent(key_im, spent);
+    }
+    //-----------------------------------------------------------------------------------------------
+    bool core::are_key_images_spent_in_pool(const std::vector<crypto::key_image>& key_im, std::vector<bool> &spent) const
+    {
+        return m_mempool.are_key_images_spent(key_im, spent);
     }
     //-----------------------------------------------------------------------------------------------
     std::pair<uint64_t, uint64_t> core::get_coinbase_tx_sum(const uint64_t start_offset, const size_t count)
@@ -742,18 +748,9 @@ namespace cryptonote
         return true;
     }
     //-----------------------------------------------------------------------------------------------
-    void core::on_transaction_relayed(const cryptonote::blobdata& tx_blob)
+    void core::on_transactions_relayed(const std::list<crypto::hash>& tx_hashes)
     {
-        std::list<std::pair<crypto::hash, cryptonote::transaction>> txs;
-        cryptonote::transaction tx;
-        crypto::hash tx_hash, tx_prefix_hash;
-        if (!parse_and_validate_tx_from_blob(tx_blob, tx, tx_hash, tx_prefix_hash))
-        {
-            LOG_ERROR("Failed to parse relayed transaction");
-            return;
-        }
-        txs.push_back(std::make_pair(tx_hash, std::move(tx)));
-        m_mempool.set_relayed(txs);
+        m_mempool.set_relayed(tx_hashes);
     }
     //-----------------------------------------------------------------------------------------------
     bool core::get_block_template(block& b, const account_public_address& adr, difficulty_type& diffic, uint64_t& height, const blobdata& ex_nonce)
@@ -766,9 +763,9 @@ namespace cryptonote
         return m_blockchain_storage.find_blockchain_supplement(qblock_ids, resp);
     }
     //-----------------------------------------------------------------------------------------------
-    bool core::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count) const
+    bool core::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count, size_t max_size) const
     {
-        return m_blockchain_storage.find_blockchain_supplement(req_start_block, qblock_ids, blocks, total_height, start_height, max_count);
+        return m_blockchain_storage.find_blockchain_supplement(req_start_block, qblock_ids, blocks, total_height, start_height, max_count, max_size);
     }
     //-----------------------------------------------------------------------------------------------
     void core::print_blockchain(uint64_t start_index, uint64_t end_index) const
@@ -873,12 +870,18 @@ namespace cryptonote
     }
 
     //-----------------------------------------------------------------------------------------------
-    bool core::prepare_handle_incoming_blocks(const std::list<block_complete_entry> &blocks)
+    bool core::prepare_handle_incoming_blocks(const std::list<block_complete_entry> &blocks_entry, std::vector<block> &blocks)
     {
-        m_blockchain_storage.prepare_handle_incoming_blocks(blocks);
+        m_blockchain_storage.prepare_handle_incoming_blocks(blocks_entry, blocks);
         return true;
     }
 
+    //-----------------------------------------------------------------------------------------------
+    void core::precompute_block_longhashes(uint64_t start_height, const std::list<block_complete_entry> &blocks_entry)
+    {
+        m_blockchain_storage.precompute_block_longhashes(start_height, blocks_entry);
+    }
+
     //-----------------------------------------------------------------------------------------------
     bool core::cleanup_handle_incoming_blocks(bool force_sync)
     {
@@ -981,7 +984,7 @@ namespace cryptonote
 
     }
     //-----------------------------------------------------------------------------------------------
-    bool core::handle_incoming_block(const blobdata& block_blob, block_verification_context& bvc, bool update_miner_blocktemplate)
+    bool core::handle_incoming_block(const blobdata& block_blob, const block *b, block_verification_context& bvc, bool update_miner_blocktemplate)
     {
         // load json & DNS checkpoints every 10min/hour respectively,
         // and verify them with respect to what blocks we already have
@@ -995,8 +998,18 @@ namespace cryptonote
             return false;
         }
 
-        block b = AUTO_VAL_INIT(b);
-        if(!parse_and_validate_block_from_blob(block_blob, b) || (unsigned)b.timestamp>=time(NULL))
+        block lb = AUTO_VAL_INIT(lb);
+        if (!b)
+        {
+            if(!parse_and_validate_block_from_blob(block_blob, lb))
+            {
+                LOG_PRINT_L1("Failed to parse and validate new block");
+                bvc.m_verifivation_failed = true;
+                return false;
+            }
+            b = &lb;
+        }
+        if((unsigned)b->timestamp>=time(NULL))
         {
             LOG_PRINT_L1("Failed to parse and validate new block");
             bvc.m_verifivation_failed = true;
@@ -1030,7 +1043,7 @@ namespace cryptonote
             }
         }*/
 
-        add_new_block(b, bvc);
+        add_new_block(*b, bvc);
         if(update_miner_blocktemplate && bvc.m_added_to_main_chain)
             update_miner_block_template();
         return true;
@@ -70,10 +70,10 @@ namespace cryptonote
   //---------------------------------------------------------------
   void get_transaction_prefix_hash(const transaction_prefix& tx, crypto::hash& h)
   {
-    std::ostringstream s;
-    binary_archive<true> a(s);
+    cn_fast_hash_sink sink;
+    binary_archive<true> a(sink);
     ::serialization::serialize(a, const_cast<transaction_prefix&>(tx));
-    crypto::cn_fast_hash(s.str().data(), s.str().size(), h);
+    sink.finish(h);
   }
   //---------------------------------------------------------------
   crypto::hash get_transaction_prefix_hash(const transaction_prefix& tx)
@@ -85,19 +85,23 @@ namespace cryptonote
   //---------------------------------------------------------------
   bool parse_and_validate_tx_from_blob(const blobdata& tx_blob, transaction& tx)
   {
-    std::stringstream ss;
-    ss << tx_blob;
-    binary_archive<false> ba(ss);
+    binary_archive<false> ba{epee::strspan<std::uint8_t>(tx_blob)};
     bool r = ::serialization::serialize(ba, tx);
     CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
     return true;
   }
   //---------------------------------------------------------------
+  bool parse_and_validate_tx_base_from_blob(const blobdata& tx_blob, transaction& tx)
+  {
+    binary_archive<false> ba{epee::strspan<std::uint8_t>(tx_blob)};
+    bool r = tx.serialize_base(ba);
+    CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction base from blob");
+    return true;
+  }
+  //---------------------------------------------------------------
   bool parse_and_validate_tx_from_blob(const blobdata& tx_blob, transaction& tx, crypto::hash& tx_hash, crypto::hash& tx_prefix_hash)
   {
-    std::stringstream ss;
-    ss << tx_blob;
-    binary_archive<false> ba(ss);
+    binary_archive<false> ba{epee::strspan<std::uint8_t>(tx_blob)};
     bool r = ::serialization::serialize(ba, tx);
     CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
     //TODO: validate tx
@@ -356,9 +360,7 @@ namespace cryptonote
     if(tx_extra.empty())
       return true;
 
-    std::string extra_str(reinterpret_cast<const char*>(tx_extra.data()), tx_extra.size());
-    std::istringstream iss(extra_str);
-    binary_archive<false> ar(iss);
+    binary_archive<false> ar{epee::to_span(tx_extra)};
 
     bool eof = false;
     while (!eof)
@@ -368,9 +370,9 @@ namespace cryptonote
       CHECK_AND_NO_ASSERT_MES_L1(r, false, "failed to deserialize extra field. extra = " << string_tools::buff_to_hex_nodelimer(std::string(reinterpret_cast<const char*>(tx_extra.data()), tx_extra.size())));
       tx_extra_fields.push_back(field);
 
-      std::ios_base::iostate state = iss.rdstate();
-      eof = (EOF == iss.peek());
-      iss.clear(state);
+      std::ios_base::iostate state = ar.stream().rdstate();
+      eof = (EOF == ar.stream().peek());
+      ar.stream().clear(state);
     }
     CHECK_AND_NO_ASSERT_MES_L1(::serialization::check_stream_state(ar), false, "failed to deserialize extra field. extra = " << string_tools::buff_to_hex_nodelimer(std::string(reinterpret_cast<const char*>(tx_extra.data()), tx_extra.size())));
 
@@ -429,12 +431,11 @@ namespace cryptonote
     // convert to variant
     tx_extra_field field = tx_extra_additional_pub_keys{ additional_pub_keys };
     // serialize
-    std::ostringstream oss;
-    binary_archive<true> ar(oss);
+    std::string tx_extra_str;
+    binary_archive<true> ar(tx_extra_str);
     bool r = ::do_serialize(ar, field);
     CHECK_AND_NO_ASSERT_MES_L1(r, false, "failed to serialize tx extra additional tx pub keys");
     // append
-    std::string tx_extra_str = oss.str();
     size_t pos = tx_extra.size();
     tx_extra.resize(tx_extra.size() + tx_extra_str.size());
     memcpy(&tx_extra[pos], tx_extra_str.data(), tx_extra_str.size());
@@ -459,11 +460,9 @@ namespace cryptonote
   //---------------------------------------------------------------
   bool remove_field_from_tx_extra(std::vector<uint8_t>& tx_extra, const std::type_info &type)
   {
-    std::string extra_str(reinterpret_cast<const char*>(tx_extra.data()), tx_extra.size());
-    std::istringstream iss(extra_str);
-    binary_archive<false> ar(iss);
-    std::ostringstream oss;
-    binary_archive<true> newar(oss);
+    binary_archive<false> ar{epee::to_span(tx_extra)};
+    std::string s;
+    binary_archive<true> newar(s);
 
     bool eof = false;
     while (!eof)
@@ -474,15 +473,12 @@ namespace cryptonote
       if (field.type() != type)
         ::do_serialize(newar, field);
 
-      std::ios_base::iostate state = iss.rdstate();
-      eof = (EOF == iss.peek());
-      iss.clear(state);
+      std::ios_base::iostate state = ar.stream().rdstate();
+      eof = (EOF == ar.stream().peek());
+      ar.stream().clear(state);
     }
     CHECK_AND_NO_ASSERT_MES_L1(::serialization::check_stream_state(ar), false, "failed to deserialize extra field. extra = " << string_tools::buff_to_hex_nodelimer(std::string(reinterpret_cast<const char*>(tx_extra.data()), tx_extra.size())));
-    tx_extra.clear();
-    std::string s = oss.str();
-    tx_extra.reserve(s.size());
-    std::copy(s.begin(), s.end(), std::back_inserter(tx_extra));
+    tx_extra.assign(s.begin(), s.end());
     return true;
   }
   //---------------------------------------------------------------
@@ -1143,20 +1139,31 @@ namespace cryptonote
     // v2 transactions hash different parts together, than hash the set of those hashes
     crypto::hash hashes[3];
 
+    // each part is hashed as it is serialized, and the blob size is the
+    // sum of their sizes, so the blob itself is never put together
+    size_t size = 0;
+
     // prefix
-    get_transaction_prefix_hash(t, hashes[0]);
+    {
+      cn_fast_hash_sink sink;
+      binary_archive<true> ba(sink);
+      ::serialization::serialize(ba, const_cast<transaction_prefix&>(static_cast<const transaction_prefix&>(t)));
+      sink.finish(hashes[0]);
+      size += ba.size();
+    }
 
     transaction &tt = const_cast<transaction&>(t);
 
     // base rct
     {
-      std::stringstream ss;
-      binary_archive<true> ba(ss);
+      cn_fast_hash_sink sink;
+      binary_archive<true> ba(sink);
       const size_t inputs = t.vin.size();
       const size_t outputs = t.vout.size();
       bool r = tt.rct_signatures.serialize_rctsig_base(ba, inputs, outputs);
       CHECK_AND_ASSERT_MES(r, false, "Failed to serialize rct signatures base");
-      cryptonote::get_blob_hash(ss.str(), hashes[1]);
+      sink.finish(hashes[1]);
+      size += ba.size();
     }
 
     // prunable rct
@@ -1166,22 +1173,23 @@ namespace cryptonote
     }
     else
     {
-      std::stringstream ss;
-      binary_archive<true> ba(ss);
+      cn_fast_hash_sink sink;
+      binary_archive<true> ba(sink);
       const size_t inputs = t.vin.size();
       const size_t outputs = t.vout.size();
       const size_t mixin = t.vin.empty() ? 0 : t.vin[0].type() == typeid(txin_to_key) ? boost::get<txin_to_key>(t.vin[0]).key_offsets.size() - 1 : 0;
       bool r = tt.rct_signatures.p.serialize_rctsig_prunable(ba, t.rct_signatures.type, inputs, outputs, mixin);
       CHECK_AND_ASSERT_MES(r, false, "Failed to serialize rct signatures prunable");
-      cryptonote::get_blob_hash(ss.str(), hashes[2]);
+      sink.finish(hashes[2]);
+      size += ba.size();
     }
 
     // the tx hash is the hash of the 3 hashes
     res = cn_fast_hash(hashes, sizeof(hashes));
 
-    // we still need the size
+    // a tx without inputs has no signatures in its blob
     if (blob_size)
-      *blob_size = get_object_blobsize(t);
+      *blob_size = t.vin.empty() ? get_object_blobsize(t) : size;
 
     return true;
   }
@@ -1193,7 +1201,9 @@ namespace cryptonote
   //---------------------------------------------------------------
   blobdata get_block_hashing_blob(const block& b)
   {
-    blobdata blob = t_serializable_object_to_blob(static_cast<block_header>(b));
+    blobdata blob;
+    binary_archive<true> ba(blob);
+    ::serialization::serialize(ba, const_cast<block_header&>(static_cast<const block_header&>(b)));
     crypto::hash tree_root_hash = get_tx_tree_hash(b);
     blob.append(reinterpret_cast<const char*>(&tree_root_hash), sizeof(tree_root_hash));
     blob.append(tools::get_varint_data(b.tx_hashes.size()+1));
@@ -1278,9 +1288,7 @@ namespace cryptonote
   //---------------------------------------------------------------
   bool parse_and_validate_block_from_blob(const blobdata& b_blob, block& b)
   {
-    std::stringstream ss;
-    ss << b_blob;
-    binary_archive<false> ba(ss);
+    binary_archive<false> ba{epee::strspan<std::uint8_t>(b_blob)};
     bool r = ::serialization::serialize(ba, b);
     CHECK_AND_ASSERT_MES(r, false, "Failed to parse block from blob");
     return true;
@@ -1306,6 +1314,20 @@ namespace cryptonote
     return t_serializable_object_to_blob(tx, b_blob);
   }
   //---------------------------------------------------------------
+  blobdata pruned_tx_to_blob(const transaction& tx)
+  {
+    blobdata b;
+    pruned_tx_to_blob(tx, b);
+    return b;
+  }
+  //---------------------------------------------------------------
+  bool pruned_tx_to_blob(const transaction& tx, blobdata& b_blob)
+  {
+    b_blob.clear();
+    binary_archive<true> ba(b_blob);
+    return const_cast<transaction&>(tx).serialize_base(ba);
+  }
+  //---------------------------------------------------------------
   void get_tx_tree_hash(const std::vector<crypto::hash>& tx_hashes, crypto::hash& h)
   {
     tree_hash(tx_hashes.data(), tx_hashes.size(), h);
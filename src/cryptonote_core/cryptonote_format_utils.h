@@ -36,6 +36,7 @@
 #include "include_base_utils.h"
 #include "crypto/crypto.h"
 #include "crypto/hash.h"
+#include "crypto/keccak.h"
 #include "crypto/cn_slow_hash.hpp"
 #include "ringct/rctOps.h"
 #include <unordered_map>
@@ -48,6 +49,7 @@ namespace cryptonote
   crypto::hash get_transaction_prefix_hash(const transaction_prefix& tx);
   bool parse_and_validate_tx_from_blob(const blobdata& tx_blob, transaction& tx, crypto::hash& tx_hash, crypto::hash& tx_prefix_hash);
   bool parse_and_validate_tx_from_blob(const blobdata& tx_blob, transaction& tx);
+  bool parse_and_validate_tx_base_from_blob(const blobdata& tx_blob, transaction& tx);
   bool construct_miner_tx(size_t height, size_t median_size, uint64_t already_generated_coins, size_t current_block_size, uint64_t fee, const account_public_address &miner_address, transaction& tx, const blobdata& extra_nonce = blobdata(), size_t max_outs = 1, uint8_t hard_fork_version = 1);
   bool encrypt_payment_id(crypto::hash8 &payment_id, const crypto::public_key &public_key, const crypto::secret_key &secret_key);
   bool decrypt_payment_id(crypto::hash8 &payment_id, const crypto::public_key &public_key, const crypto::secret_key &secret_key);
@@ -173,14 +175,25 @@ namespace cryptonote
   std::vector<uint64_t> absolute_output_offsets_to_relative(const std::vector<uint64_t>& off);
   std::string print_money(uint64_t amount);
   //---------------------------------------------------------------
+  /** a binary_archive sink computing the cn_fast_hash of what is written to it */
+  class cn_fast_hash_sink: public binary_archive_sink
+  {
+  public:
+    cn_fast_hash_sink() { keccak_init(&m_ctx); }
+    virtual void write(const void *data, size_t len) { keccak_update(&m_ctx, static_cast<const uint8_t*>(data), len); }
+    void finish(crypto::hash& res) { keccak_finish(&m_ctx, reinterpret_cast<uint8_t*>(&res), sizeof(res)); }
+
+  private:
+    KECCAK_CTX m_ctx;
+  };
+  //---------------------------------------------------------------
   template<class t_object>
   bool t_serializable_object_to_blob(const t_object& to, blobdata& b_blob)
   {
-    std::stringstream ss;
-    binary_archive<true> ba(ss);
-    bool r = ::serialization::serialize(ba, const_cast<t_object&>(to));
-    b_blob = ss.str();
-    return r;
+    // written in place, so a caller reusing b_blob reuses its buffer
+    b_blob.clear();
+    binary_archive<true> ba(b_blob);
+    return ::serialization::serialize(ba, const_cast<t_object&>(to));
   }
   //---------------------------------------------------------------
   template<class t_object>
@@ -192,26 +205,30 @@ namespace cryptonote
   }
   //---------------------------------------------------------------
   template<class t_object>
-  bool get_object_hash(const t_object& o, crypto::hash& res)
+  bool get_object_hash(const t_object& o, crypto::hash& res, size_t& blob_size)
   {
-    get_blob_hash(t_serializable_object_to_blob(o), res);
+    // hashed as it is serialized, the blob itself is never put together
+    cn_fast_hash_sink sink;
+    binary_archive<true> ba(sink);
+    ::serialization::serialize(ba, const_cast<t_object&>(o));
+    sink.finish(res);
+    blob_size = ba.size();
     return true;
   }
   //---------------------------------------------------------------
   template<class t_object>
-  size_t get_object_blobsize(const t_object& o)
+  bool get_object_hash(const t_object& o, crypto::hash& res)
   {
-    blobdata b = t_serializable_object_to_blob(o);
-    return b.size();
+    size_t blob_size;
+    return get_object_hash(o, res, blob_size);
   }
   //---------------------------------------------------------------
   template<class t_object>
-  bool get_object_hash(const t_object& o, crypto::hash& res, size_t& blob_size)
+  size_t get_object_blobsize(const t_object& o)
   {
-    blobdata bl = t_serializable_object_to_blob(o);
-    blob_size = bl.size();
-    get_blob_hash(bl, res);
-    return true;
+    binary_archive<true> ba;
+    ::serialization::serialize(ba, const_cast<t_object&>(o));
+    return ba.size();
   }
   //---------------------------------------------------------------
   template <typename T>
@@ -270,6 +287,8 @@ namespace cryptonote
   bool block_to_blob(const block& b, blobdata& b_blob);
   blobdata tx_to_blob(const transaction& b);
   bool tx_to_blob(const transaction& b, blobdata& b_blob);
+  blobdata pruned_tx_to_blob(const transaction& tx);
+  bool pruned_tx_to_blob(const transaction& tx, blobdata& b_blob);
   void get_tx_tree_hash(const std::vector<crypto::hash>& tx_hashes, crypto::hash& h);
   crypto::hash get_tx_tree_hash(const std::vector<crypto::hash>& tx_hashes);
   crypto::hash get_tx_tree_hash(const block& b);
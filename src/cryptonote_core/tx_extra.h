@@ -139,8 +139,7 @@ namespace cryptonote
       if(!::do_serialize(ar, field))
         return false;
 
-      std::istringstream iss(field);
-      binary_archive<false> iar(iss);
+      binary_archive<false> iar{epee::strspan<std::uint8_t>(field)};
       serialize_helper helper(*this);
       return ::serialization::serialize(iar, helper);
     }
@@ -149,13 +148,12 @@ namespace cryptonote
     template <template <bool> class Archive>
     bool do_serialize(Archive<true>& ar)
     {
-      std::ostringstream oss;
-      binary_archive<true> oar(oss);
+      std::string field;
+      binary_archive<true> oar(field);
       serialize_helper helper(*this);
       if(!::do_serialize(oar, helper))
         return false;
 
-      std::string field = oss.str();
       return ::serialization::serialize(ar, field);
     }
   };
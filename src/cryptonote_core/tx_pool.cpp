@@ -391,12 +391,20 @@ namespace cryptonote
   }
   //---------------------------------------------------------------------------------
   void tx_memory_pool::set_relayed(const std::list<std::pair<crypto::hash, cryptonote::transaction>> &txs)
+  {
+    std::list<crypto::hash> txids;
+    for (auto it = txs.begin(); it != txs.end(); ++it)
+      txids.push_back(it->first);
+    set_relayed(txids);
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::set_relayed(const std::list<crypto::hash> &txids)
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     const time_t now = time(NULL);
-    for (auto it = txs.begin(); it != txs.end(); ++it)
+    for (auto it = txids.begin(); it != txids.end(); ++it)
     {
-      auto i = m_transactions.find(it->first);
+      auto i = m_transactions.find(*it);
       if (i != m_transactions.end())
       {
         i->second.relayed = true;
@@ -502,6 +510,16 @@ namespace cryptonote
     return m_spent_key_images.end() != m_spent_key_images.find(key_im);
   }
   //---------------------------------------------------------------------------------
+  bool tx_memory_pool::are_key_images_spent(const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent) const
+  {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    spent.clear();
+    spent.reserve(key_images.size());
+    for (const crypto::key_image& ki: key_images)
+      spent.push_back(m_spent_key_images.end() != m_spent_key_images.find(ki));
+    return true;
+  }
+  //---------------------------------------------------------------------------------
   void tx_memory_pool::lock() const
   {
     m_transactions_lock.lock();
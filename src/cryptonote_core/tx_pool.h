@@ -254,6 +254,16 @@ namespace cryptonote
      */
     bool get_transaction(const crypto::hash& h, transaction& tx) const;
 
+    /**
+     * @brief check which of a set of key images are spent by transactions in the pool
+     *
+     * @param key_images the key images to look for
+     * @param spent return-by-reference whether each key image is spent in the pool
+     *
+     * @return true
+     */
+    bool are_key_images_spent(const std::vector<crypto::key_image>& key_images, std::vector<bool>& spent) const;
+
     /**
      * @brief get a list of all relayable transactions and their hashes
      *
@@ -275,6 +285,13 @@ namespace cryptonote
      */
     void set_relayed(const std::list<std::pair<crypto::hash, cryptonote::transaction>>& txs);
 
+    /**
+     * @brief tell the pool that certain transactions were just relayed
+     *
+     * @param txids the hashes of the transactions
+     */
+    void set_relayed(const std::list<crypto::hash>& txids);
+
     /**
      * @brief get the total number of transactions in the pool
      *
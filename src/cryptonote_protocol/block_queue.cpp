@@ -0,0 +1,237 @@
+// Copyright (c) 2017-2018, The Bixbite Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+#include "misc_log_ex.h"
+#include "cryptonote_config.h"
+#include "block_queue.h"
+
+namespace cryptonote
+{
+
+block_queue::span::span(uint64_t start_block_height, uint64_t nblocks, const boost::uuids::uuid &connection_id, const boost::posix_time::ptime &time):
+  start_block_height(start_block_height), nblocks(nblocks), connection_id(connection_id), size(0), time(time), processing(false), prepared(false)
+{
+}
+
+block_queue::block_queue(): m_data_size(0)
+{
+}
+
+bool block_queue::reserve_span(uint64_t first_block_height, uint64_t last_block_height, uint64_t max_blocks, uint64_t max_span_start, const boost::uuids::uuid &connection_id, uint64_t &span_start, uint64_t &span_length)
+{
+  boost::unique_lock<boost::recursive_mutex> lock(m_mutex);
+
+  if (last_block_height < first_block_height || max_blocks == 0)
+    return false;
+
+  const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+  // hand the lowest span over if its connection is lagging well behind this one
+  std::set<span>::iterator head = m_spans.begin();
+  if (head != m_spans.end() && !head->filled() && !head->processing && head->connection_id != connection_id
+      && head->start_block_height >= first_block_height && head->start_block_height + head->nblocks - 1 <= last_block_height
+      && (now - head->time).total_seconds() >= BLOCK_QUEUE_SPAN_STEAL_TIME
+      && get_rate(head->connection_id) * 2 <= get_rate(connection_id))
+  {
+    LOG_PRINT_L1("Reassigning span " << head->start_block_height << " (" << head->nblocks << " blocks) from a slow connection");
+    span s(head->start_block_height, head->nblocks, connection_id, now);
+    m_spans.erase(head);
+    m_spans.insert(s);
+    span_start = s.start_block_height;
+    span_length = s.nblocks;
+    return true;
+  }
+
+  // find the first height not covered by a span
+  uint64_t start = first_block_height;
+  std::set<span>::const_iterator i = m_spans.begin();
+  while (i != m_spans.end() && i->start_block_height + i->nblocks <= start)
+    ++i;
+  while (i != m_spans.end() && i->start_block_height <= start)
+  {
+    start = std::max(start, i->start_block_height + i->nblocks);
+    ++i;
+  }
+  if (start > last_block_height || start > max_span_start)
+    return false;
+
+  // and stop at the next one
+  uint64_t end = std::min(last_block_height + 1, start + max_blocks);
+  if (i != m_spans.end())
+    end = std::min(end, i->start_block_height);
+
+  m_spans.insert(span(start, end - start, connection_id, now));
+  span_start = start;
+  span_length = end - start;
+  return true;
+}
+
+bool block_queue::add_blocks(uint64_t start_block_height, std::list<block_complete_entry> blocks, const boost::uuids::uuid &connection_id, size_t size)
+{
+  boost::unique_lock<boost::recursive_mutex> lock(m_mutex);
+
+  const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+  span s(start_block_height, blocks.size(), connection_id, now);
+  std::set<span>::iterator i = m_spans.find(s);
+  if (i != m_spans.end())
+  {
+    if (i->filled() || i->processing)
+      return false;
+
+    // rate the connection on how long it took to fill its span
+    if (i->connection_id == connection_id)
+    {
+      const float seconds = std::max<float>((now - i->time).total_milliseconds() / 1000.0f, 0.001f);
+      const float rate = size / seconds;
+      std::map<boost::uuids::uuid, float>::iterator r = m_rates.find(connection_id);
+      if (r == m_rates.end())
+        m_rates[connection_id] = rate;
+      else
+        r->second = r->second * 0.75f + rate * 0.25f;
+    }
+    m_spans.erase(i);
+  }
+
+  s.blocks = std::move(blocks);
+  s.size = size;
+  m_data_size += size;
+  m_spans.insert(std::move(s));
+  return true;
+}
+
+bool block_queue::get_next_span(uint64_t height, span &s)
+{
+  boost::unique_lock<boost::recursive_mutex> lock(m_mutex);
+
+  std::set<span>::iterator i = m_spans.begin();
+  while (i != m_spans.end() && i->start_block_height <= height)
+  {
+    if (i->start_block_height + i->nblocks <= height && !i->processing)
+    {
+      // already in the chain, through another span or a new block notification
+      if (i->filled())
+        m_data_size -= i->size;
+      m_spans.erase(i++);
+      continue;
+    }
+    if (!i->filled())
+      return false;
+    // only the blocks change, which the ordering does not depend on
+    s = std::move(const_cast<span&>(*i));
+    span marker(s.start_block_height, s.nblocks, s.connection_id, s.time);
+    marker.processing = true;
+    m_data_size -= s.size;
+    m_spans.erase(i);
+    m_spans.insert(marker);
+    return true;
+  }
+  return false;
+}
+
+void block_queue::remove_span(uint64_t start_block_height)
+{
+  boost::unique_lock<boost::recursive_mutex> lock(m_mutex);
+
+  std::set<span>::iterator i = m_spans.find(span(start_block_height, 0, boost::uuids::uuid(), boost::posix_time::ptime()));
+  if (i == m_spans.end())
+    return;
+  if (i->filled())
+    m_data_size -= i->size;
+  m_spans.erase(i);
+}
+
+bool block_queue::has_next_span(uint64_t height) const
+{
+  boost::unique_lock<boost::recursive_mutex> lock(m_mutex);
+
+  for (std::set<span>::const_iterator i = m_spans.begin(); i != m_spans.end() && i->start_block_height <= height; ++i)
+  {
+    if (i->start_block_height + i->nblocks > height)
+      return i->filled();
+  }
+  return false;
+}
+
+bool block_queue::get_span_to_prepare(uint64_t height, uint64_t &start_block_height, std::list<block_complete_entry> &blocks)
+{
+  boost::unique_lock<boost::recursive_mutex> lock(m_mutex);
+
+  for (std::set<span>::iterator i = m_spans.begin(); i != m_spans.end(); ++i)
+  {
+    if (i->start_block_height <= height || !i->filled() || i->processing || i->prepared)
+      continue;
+    // the flag does not affect the ordering
+    const_cast<span&>(*i).prepared = true;
+    start_block_height = i->start_block_height;
+    blocks = i->blocks;
+    return true;
+  }
+  return false;
+}
+
+void block_queue::flush_spans(const boost::uuids::uuid &connection_id, bool include_filled)
+{
+  boost::unique_lock<boost::recursive_mutex> lock(m_mutex);
+
+  std::set<span>::iterator i = m_spans.begin();
+  while (i != m_spans.end())
+  {
+    if (i->connection_id == connection_id && !i->processing && (include_filled || !i->filled()))
+    {
+      if (i->filled())
+        m_data_size -= i->size;
+      m_spans.erase(i++);
+    }
+    else
+      ++i;
+  }
+  m_rates.erase(connection_id);
+}
+
+size_t block_queue::get_data_size() const
+{
+  boost::unique_lock<boost::recursive_mutex> lock(m_mutex);
+  return m_data_size;
+}
+
+size_t block_queue::get_num_spans() const
+{
+  boost::unique_lock<boost::recursive_mutex> lock(m_mutex);
+  return m_spans.size();
+}
+
+float block_queue::get_rate(const boost::uuids::uuid &connection_id) const
+{
+  boost::unique_lock<boost::recursive_mutex> lock(m_mutex);
+  std::map<boost::uuids::uuid, float>::const_iterator i = m_rates.find(connection_id);
+  return i == m_rates.end() ? 0.0f : i->second;
+}
+
+}
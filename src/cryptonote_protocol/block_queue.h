@@ -0,0 +1,193 @@
+// Copyright (c) 2017-2018, The Bixbite Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <set>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "cryptonote_protocol_defs.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief blocks being downloaded during sync, keyed by height span
+   *
+   * Each connection reserves a span of heights before asking its peer for
+   * those blocks, so several peers can download disjoint spans at the same
+   * time. Responses fill their span in whatever order they arrive, and are
+   * taken out again in height order to be added to the chain.
+   *
+   * The download rate of every connection is tracked, so a span held up by a
+   * slow peer can be handed over to a faster one.
+   */
+  class block_queue
+  {
+  public:
+    struct span
+    {
+      uint64_t start_block_height;
+      uint64_t nblocks;
+      std::list<block_complete_entry> blocks;
+      boost::uuids::uuid connection_id;
+      size_t size;
+      boost::posix_time::ptime time;
+      bool processing;
+      bool prepared;
+
+      span(uint64_t start_block_height, uint64_t nblocks, const boost::uuids::uuid &connection_id, const boost::posix_time::ptime &time);
+      bool operator<(const span &s) const { return start_block_height < s.start_block_height; }
+      bool filled() const { return !blocks.empty(); }
+    };
+
+    block_queue();
+
+    /**
+     * @brief reserves the first span of heights nobody else has
+     *
+     * Looks for the lowest height in [first_block_height, last_block_height]
+     * not yet reserved or downloaded, and reserves up to max_blocks heights
+     * from there, stopping at the next existing span.
+     *
+     * If the lowest span is still pending with a connection at most half as
+     * fast as this one and has been for BLOCK_QUEUE_SPAN_STEAL_TIME seconds,
+     * it is handed over to this connection instead.
+     *
+     * @param first_block_height the first height the peer can provide
+     * @param last_block_height the last height the peer can provide
+     * @param max_blocks the max number of blocks in the span
+     * @param max_span_start the span is not reserved if it would start above this
+     * @param connection_id the connection the span is for
+     * @param span_start return-by-reference the first height of the span
+     * @param span_length return-by-reference the number of blocks in the span
+     *
+     * @return true if a span was reserved, otherwise false
+     */
+    bool reserve_span(uint64_t first_block_height, uint64_t last_block_height, uint64_t max_blocks, uint64_t max_span_start, const boost::uuids::uuid &connection_id, uint64_t &span_start, uint64_t &span_length);
+
+    /**
+     * @brief fills a span with the blocks downloaded for it
+     *
+     * The span does not need to still be reserved by this connection, as
+     * long as no other connection filled it first.
+     *
+     * @param start_block_height the first height of the span
+     * @param blocks the blocks
+     * @param connection_id the connection the blocks came from
+     * @param size the size of the response, used to rate the connection
+     *
+     * @return true if the blocks were queued, false if the span was already filled
+     */
+    bool add_blocks(uint64_t start_block_height, std::list<block_complete_entry> blocks, const boost::uuids::uuid &connection_id, size_t size);
+
+    /**
+     * @brief takes the blocks of the filled span which continues the chain
+     *
+     * The span itself stays in the queue, marked as being processed, so its
+     * heights are not handed out again until remove_span is called once the
+     * blocks are in the chain (or were rejected). Spans which end at or below
+     * height are dropped along the way.
+     *
+     * @param height the current blockchain height
+     * @param s return-by-reference the span, with its blocks
+     *
+     * @return true if such a span was found, otherwise false
+     */
+    bool get_next_span(uint64_t height, span &s);
+
+    /**
+     * @brief removes a span
+     *
+     * @param start_block_height the first height of the span
+     */
+    void remove_span(uint64_t start_block_height);
+
+    /**
+     * @brief checks whether get_next_span would find a span
+     *
+     * @param height the current blockchain height
+     *
+     * @return true if a filled span continues the chain, otherwise false
+     */
+    bool has_next_span(uint64_t height) const;
+
+    /**
+     * @brief copies the blocks of a filled span which is not next yet
+     *
+     * Used to get work done on spans while waiting for the one which
+     * continues the chain. Each span is only returned once.
+     *
+     * @param height the current blockchain height
+     * @param start_block_height return-by-reference the first height of the span
+     * @param blocks return-by-reference a copy of the span's blocks
+     *
+     * @return true if such a span was found, otherwise false
+     */
+    bool get_span_to_prepare(uint64_t height, uint64_t &start_block_height, std::list<block_complete_entry> &blocks);
+
+    /**
+     * @brief drops the spans of a connection
+     *
+     * @param connection_id the connection
+     * @param include_filled whether to drop blocks already downloaded too
+     */
+    void flush_spans(const boost::uuids::uuid &connection_id, bool include_filled);
+
+    /**
+     * @brief gets the total size of the blocks waiting in the queue
+     *
+     * @return the size in bytes
+     */
+    size_t get_data_size() const;
+
+    /**
+     * @brief gets the number of spans, pending and filled
+     *
+     * @return the number of spans
+     */
+    size_t get_num_spans() const;
+
+    /**
+     * @brief gets the measured download rate of a connection
+     *
+     * @param connection_id the connection
+     *
+     * @return the rate in bytes per second, 0 if nothing was measured yet
+     */
+    float get_rate(const boost::uuids::uuid &connection_id) const;
+
+  private:
+    std::set<span> m_spans;
+    std::map<boost::uuids::uuid, float> m_rates;
+    size_t m_data_size;
+    mutable boost::recursive_mutex m_mutex;
+  };
+}
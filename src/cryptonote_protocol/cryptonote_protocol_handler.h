@@ -36,13 +36,22 @@
 #pragma once
 
 #include <boost/program_options/variables_map.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <string>
 #include <ctime>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_set>
 
+#include "math_helper.h"
 #include "storages/levin_abstract_invoke2.h"
 #include "warnings.h"
 #include "cryptonote_protocol_defs.h"
 #include "cryptonote_protocol_handler_common.h"
+#include "block_queue.h"
 #include "cryptonote_core/connection_context.h"
 #include "cryptonote_core/cryptonote_stat_info.h"
 #include "cryptonote_core/verification_context.h"
@@ -106,6 +115,7 @@ namespace cryptonote
     bool get_payload_sync_data(CORE_SYNC_DATA& hshd);
     bool get_stat_info(core_stat_info& stat_inf);
     bool on_callback(cryptonote_connection_context& context);
+    void on_connection_close(cryptonote_connection_context& context);
     t_core& get_core(){return m_core;}
     bool is_synchronized(){return m_synchronized;}
     void log_connections();
@@ -127,17 +137,46 @@ namespace cryptonote
     virtual bool relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg, cryptonote_connection_context& exclude_context);
     //----------------------------------------------------------------------------------
     //bool get_payload_sync_data(HANDSHAKE_DATA::request& hshd, cryptonote_connection_context& context);
-    bool request_missing_objects(cryptonote_connection_context& context, bool check_having_blocks);
+    bool request_missing_objects(cryptonote_connection_context& context);
+    void update_fluffy_stats(const std::list<blobdata>& block_txs, const std::list<blobdata>& received_txs);
+    void add_known_transactions(const boost::uuids::uuid& connection_id, const std::list<blobdata>& txs);
+    bool relay_pending_transactions();
+    void sync_thread();
+    void wake_sync_thread();
+    bool process_queued_spans();
+    bool add_span_blocks(const block_queue::span& span);
+    bool request_idle_connections();
+    void drop_connection(const boost::uuids::uuid& connection_id, bool add_fail);
     size_t get_synchronizing_connections_count();
     bool on_connection_synchronized();
     t_core& m_core;
 
+    // txs waiting to be relayed to a peer, and the ones it already has
+    struct tx_relay_peer
+    {
+      std::unordered_set<crypto::hash> known_txs;
+      std::list<std::shared_ptr<const blobdata>> pending_txs;
+      boost::posix_time::ptime next_relay_time;
+    };
+
     nodetool::p2p_endpoint_stub<connection_context> m_p2p_stub;
     nodetool::i_p2p_endpoint<connection_context>* m_p2p;
     std::atomic<uint32_t> m_syncronized_connections_count;
     std::atomic<bool> m_synchronized;
     bool m_one_request = true;
     std::atomic<bool> m_stopping;
+    block_queue m_block_queue;
+    boost::mutex m_sync_lock;
+    boost::condition_variable m_sync_cond;
+    boost::thread m_sync_thread;
+    epee::math_helper::once_a_time_seconds<5> m_idle_connections_interval;
+    std::atomic<uint64_t> m_fluffy_blocks;
+    std::atomic<uint64_t> m_fluffy_txs;
+    std::atomic<uint64_t> m_fluffy_txs_from_pool;
+    std::atomic<uint64_t> m_fluffy_bytes_saved;
+    std::map<boost::uuids::uuid, tx_relay_peer> m_tx_relay_peers;
+    boost::mutex m_tx_relay_lock;
+    std::atomic<uint64_t> m_tx_relay_bytes_saved;
 
 		// static std::ofstream m_logreq;
     boost::mutex m_buffer_mutex;
@@ -61,7 +61,12 @@ namespace cryptonote
                                                                                                               m_p2p(p_net_layout),
                                                                                                               m_syncronized_connections_count(0),
                                                                                                               m_synchronized(false),
-                                                                                                              m_stopping(false)
+                                                                                                              m_stopping(false),
+                                                                                                              m_fluffy_blocks(0),
+                                                                                                              m_fluffy_txs(0),
+                                                                                                              m_fluffy_txs_from_pool(0),
+                                                                                                              m_fluffy_bytes_saved(0),
+                                                                                                              m_tx_relay_bytes_saved(0)
 
   {
     if(!m_p2p)
@@ -71,12 +76,19 @@ namespace cryptonote
   template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::init(const boost::program_options::variables_map& vm)
   {
+    // downloaded blocks are verified and added on their own thread, so the
+    // network threads only queue them and go back to serving connections
+    m_sync_thread = boost::thread(boost::bind(&t_cryptonote_protocol_handler<t_core>::sync_thread, this));
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::deinit()
   {
+    m_stopping = true;
+    wake_sync_thread();
+    if (m_sync_thread.joinable())
+      m_sync_thread.join();
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -98,16 +110,35 @@ namespace cryptonote
 
     if(context.m_state == cryptonote_connection_context::state_synchronizing)
     {
-      NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-      m_core.get_short_chain_history(r.block_ids);
-      LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size() );
-      post_notify<NOTIFY_REQUEST_CHAIN>(r, context);
+      if(context.m_needed_objects.size())
+      {
+        // woken up while waiting for a span to free up
+        if(context.m_requested_objects.empty())
+          request_missing_objects(context);
+      }
+      else
+      {
+        NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+        m_core.get_short_chain_history(r.block_ids);
+        LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size() );
+        post_notify<NOTIFY_REQUEST_CHAIN>(r, context);
+      }
     }
 
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
+  void t_cryptonote_protocol_handler<t_core>::on_connection_close(cryptonote_connection_context& context)
+  {
+    // let other connections download what this one had not delivered yet
+    m_block_queue.flush_spans(context.m_connection_id, false);
+
+    boost::lock_guard<boost::mutex> lock(m_tx_relay_lock);
+    m_tx_relay_peers.erase(context.m_connection_id);
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::get_stat_info(core_stat_info& stat_inf)
   {
     return m_core.get_stat_info(stat_inf);
@@ -325,7 +356,8 @@ namespace cryptonote
     m_core.pause_mine();
     std::list<block_complete_entry> blocks;
     blocks.push_back(arg.b);
-    m_core.prepare_handle_incoming_blocks(blocks);
+    std::vector<block> pblocks;
+    m_core.prepare_handle_incoming_blocks(blocks, pblocks);
     for(auto tx_blob_it = arg.b.txs.begin(); tx_blob_it!=arg.b.txs.end();tx_blob_it++)
     {
       cryptonote::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
@@ -341,7 +373,7 @@ namespace cryptonote
     }
 
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    m_core.handle_incoming_block(arg.b.block, bvc); // got block from handle_notify_new_block
+    m_core.handle_incoming_block(arg.b.block, pblocks.empty() ? NULL : &pblocks[0], bvc); // got block from handle_notify_new_block
     m_core.cleanup_handle_incoming_blocks(true);
     m_core.resume_mine();
     if(bvc.m_system_time_incorrect)
@@ -563,16 +595,19 @@ namespace cryptonote
       }
       else // whoo-hoo we've got em all ..
       {
+        update_fluffy_stats(have_tx, arg.b.txs);
+
         block_complete_entry b;
         b.block = arg.b.block;
         b.txs = have_tx;
 
         std::list<block_complete_entry> blocks;
         blocks.push_back(b);
-        m_core.prepare_handle_incoming_blocks(blocks);
+        std::vector<block> pblocks;
+        m_core.prepare_handle_incoming_blocks(blocks, pblocks);
           
         block_verification_context bvc = boost::value_initialized<block_verification_context>();
-        m_core.handle_incoming_block(arg.b.block, bvc); // got block from handle_notify_new_block
+        m_core.handle_incoming_block(arg.b.block, &new_block, bvc); // got block from handle_notify_new_block
         m_core.cleanup_handle_incoming_blocks(true);
         m_core.resume_mine();
         
@@ -630,34 +665,26 @@ namespace cryptonote
   {
     LOG_PRINT_CCONTEXT_L2("NOTIFY_REQUEST_FLUFFY_MISSING_TX");
     
-    std::list<block> local_blocks;
-    std::list<transaction> local_txs;
-    if(!m_core.get_blocks(arg.current_blockchain_height - 1, 1, local_blocks, local_txs))
+    // look the block up by hash rather than height, the chain may have
+    // grown since the block was announced
+    block b;
+    if(!parse_and_validate_block_from_blob(arg.b.block, b) || !m_core.get_block_by_hash(get_block_hash(b), b))
     {
-
       LOG_ERROR_CCONTEXT
       (
         "Failed to handle request NOTIFY_REQUEST_FLUFFY_MISSING_TX"
-        << ", get_blocks( start_offset = " << (arg.current_blockchain_height - 1) << " ) failed"
+        << ", unknown block, block_height = " << arg.current_blockchain_height
         << ", dropping connection"
       );
-      
+
       m_p2p->drop_connection(context);
-      return 1;            
+      return 1;
     }
 
-    NOTIFY_NEW_FLUFFY_BLOCK::request fluffy_response;
-    fluffy_response.b = arg.b;
-    fluffy_response.current_blockchain_height = m_core.get_current_blockchain_height();
-    fluffy_response.hop = arg.hop;    
-    size_t local_txs_count = local_txs.size();
+    std::vector<crypto::hash> txids;
     BOOST_FOREACH(auto& tx_idx, arg.missing_tx_indices)
     {
-      if(tx_idx < local_txs_count)
-      {
-        fluffy_response.b.txs.push_back(t_serializable_object_to_blob( *(std::next(local_txs.begin(), tx_idx)) ));
-      }
-      else
+      if(tx_idx >= b.tx_hashes.size())
       {
         LOG_ERROR_CCONTEXT
         (
@@ -666,12 +693,42 @@ namespace cryptonote
           << ", tx index = " << tx_idx << ", block_height = " << arg.current_blockchain_height
           << ", dropping connection"
         );
-        
+
         m_p2p->drop_connection(context);
         return 1;
       }
-    }    
-            
+      txids.push_back(b.tx_hashes[tx_idx]);
+    }
+
+    // an alternative block's txs may still be in the pool
+    std::list<transaction> txs;
+    std::list<crypto::hash> missed_txs;
+    m_core.get_transactions(txids, txs, missed_txs);
+    BOOST_FOREACH(auto& tx_hash, missed_txs)
+    {
+      transaction tx;
+      if(!m_core.get_pool_transaction(tx_hash, tx))
+      {
+        LOG_ERROR_CCONTEXT
+        (
+          "Failed to handle request NOTIFY_REQUEST_FLUFFY_MISSING_TX"
+          << ", tx " << tx_hash << " not found"
+          << ", dropping connection"
+        );
+
+        m_p2p->drop_connection(context);
+        return 1;
+      }
+      txs.push_back(tx);
+    }
+
+    NOTIFY_NEW_FLUFFY_BLOCK::request fluffy_response;
+    fluffy_response.b = arg.b;
+    fluffy_response.current_blockchain_height = m_core.get_current_blockchain_height();
+    fluffy_response.hop = arg.hop;
+    BOOST_FOREACH(auto& tx, txs)
+      fluffy_response.b.txs.push_back(t_serializable_object_to_blob(tx));
+
     LOG_PRINT_CCONTEXT_L2
     (
         "-->>NOTIFY_RESPONSE_FLUFFY_MISSING_TX: " 
@@ -684,16 +741,45 @@ namespace cryptonote
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
+  void t_cryptonote_protocol_handler<t_core>::update_fluffy_stats(const std::list<blobdata>& block_txs, const std::list<blobdata>& received_txs)
+  {
+    // every tx of the block we did not need to download is a hit
+    uint64_t block_bytes = 0, received_bytes = 0;
+    BOOST_FOREACH(auto& tx_blob, block_txs)
+      block_bytes += tx_blob.size();
+    BOOST_FOREACH(auto& tx_blob, received_txs)
+      received_bytes += tx_blob.size();
+    const uint64_t hits = block_txs.size() - std::min(block_txs.size(), received_txs.size());
+    const uint64_t saved = block_bytes - std::min(block_bytes, received_bytes);
+
+    ++m_fluffy_blocks;
+    m_fluffy_txs += block_txs.size();
+    m_fluffy_txs_from_pool += hits;
+    m_fluffy_bytes_saved += saved;
+
+    const uint64_t total_txs = m_fluffy_txs;
+    LOG_PRINT_L1("Fluffy block reconstructed with " << hits << "/" << block_txs.size() << " txs from the pool, "
+        << saved << " bytes saved (" << m_fluffy_blocks << " blocks, "
+        << (total_txs ? m_fluffy_txs_from_pool * 100 / total_txs : 100) << "% hit rate, "
+        << m_fluffy_bytes_saved / 1024 << " kB saved in total)");
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
   int t_cryptonote_protocol_handler<t_core>::handle_notify_new_transactions(int command, NOTIFY_NEW_TRANSACTIONS::request& arg, cryptonote_connection_context& context)
   {
     LOG_PRINT_CCONTEXT_L2("NOTIFY_NEW_TRANSACTIONS");
     if(context.m_state != cryptonote_connection_context::state_normal)
       return 1;
 
+    // whatever happens to them here, there is no point sending them back
+    add_known_transactions(context.m_connection_id, arg.txs);
+
+    std::list<crypto::hash> tx_hashes;
     for(auto tx_blob_it = arg.txs.begin(); tx_blob_it!=arg.txs.end();)
     {
       cryptonote::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
-      m_core.handle_incoming_tx(*tx_blob_it, tvc, false, true);
+      crypto::hash tx_hash;
+      m_core.handle_incoming_tx(*tx_blob_it, tvc, false, true, tx_hash);
       if(tvc.m_verifivation_failed)
       {
         LOG_PRINT_CCONTEXT_L1("Tx verification failed, dropping connection");
@@ -701,7 +787,10 @@ namespace cryptonote
         return 1;
       }
       if(tvc.m_should_be_relayed)
+      {
+        tx_hashes.push_back(tx_hash);
         ++tx_blob_it;
+      }
       else
         arg.txs.erase(tx_blob_it++);
     }
@@ -710,6 +799,8 @@ namespace cryptonote
     {
       //TODO: add announce usage here
       relay_transactions(arg, context);
+      // no check for success, so tell core they're relayed unconditionally
+      m_core.on_transactions_relayed(tx_hashes);
     }
 
     return true;
@@ -802,7 +893,6 @@ namespace cryptonote
 
     context.m_remote_blockchain_height = arg.current_blockchain_height;
 
-    size_t count = 0;
     BOOST_FOREACH(const block_complete_entry& block_entry, arg.blocks)
     {
       if (m_stopping)
@@ -810,7 +900,6 @@ namespace cryptonote
         return 1;
       }
 
-      ++count;
       block b;
       if(!parse_and_validate_block_from_blob(block_entry.block, b))
       {
@@ -819,19 +908,6 @@ namespace cryptonote
         m_p2p->drop_connection(context);
         return 1;
       }
-      //to avoid concurrency in core between connections, suspend connections which delivered block later then first one
-      if(count == 2)
-      {
-        if(m_core.have_block(get_block_hash(b)))
-        {
-          context.m_state = cryptonote_connection_context::state_idle;
-          context.m_needed_objects.clear();
-          context.m_requested_objects.clear();
-          LOG_PRINT_CCONTEXT_L1("Connection set to idle state.");
-          return 1;
-        }
-      }
-
       auto req_it = context.m_requested_objects.find(get_block_hash(b));
       if(req_it == context.m_requested_objects.end())
       {
@@ -860,93 +936,214 @@ namespace cryptonote
     }
 
 
-    {
-      m_core.pause_mine();
-      epee::misc_utils::auto_scope_leave_caller scope_exit_handler = epee::misc_utils::create_scope_leave_handler(
-        boost::bind(&t_core::resume_mine, &m_core));
+    LOG_PRINT_CCONTEXT_YELLOW( "Got NEW BLOCKS inside of " << __FUNCTION__ << ": size: " << arg.blocks.size() , LOG_LEVEL_1);
 
-      LOG_PRINT_CCONTEXT_YELLOW( "Got NEW BLOCKS inside of " << __FUNCTION__ << ": size: " << arg.blocks.size() , LOG_LEVEL_1);
+    if (m_core.get_test_drop_download() && m_core.get_test_drop_download_height()) { // DISCARD BLOCKS for testing
+      // other connections download the spans before and after this one, the
+      // blocks are added to the chain in order by whichever thread gets there
+      if (!m_block_queue.add_blocks(context.m_expect_height, std::move(arg.blocks), context.m_connection_id, size))
+        LOG_PRINT_CCONTEXT_L1("Blocks from height " << context.m_expect_height << " were already downloaded from another connection");
+      else
+        wake_sync_thread();
+    }
 
-      if (m_core.get_test_drop_download() && m_core.get_test_drop_download_height()) { // DISCARD BLOCKS for testing
+    request_missing_objects(context);
+    return 1;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  void t_cryptonote_protocol_handler<t_core>::sync_thread()
+  {
+    LOG_PRINT_L1("Block sync thread started");
+    boost::unique_lock<boost::mutex> lock(m_sync_lock);
+    while (!m_stopping)
+    {
+      // nothing is queued before peers connect, which is also after the
+      // core is initialized, so the chain is not looked at before that
+      if (!m_block_queue.get_num_spans())
+      {
+        m_sync_cond.wait_for(lock, boost::chrono::seconds(1));
+        continue;
+      }
+      const uint64_t height = m_core.get_current_blockchain_height();
+      if (!m_block_queue.has_next_span(height))
+      {
+        // get the proof of work of later spans out of the way meanwhile
+        uint64_t start_height;
+        std::list<block_complete_entry> blocks;
+        if (m_block_queue.get_span_to_prepare(height, start_height, blocks))
+        {
+          lock.unlock();
+          m_core.precompute_block_longhashes(start_height, blocks);
+          lock.lock();
+          continue;
+        }
+        // woken up when a span is queued, the timeout only covers spans
+        // which became next through a new block notification
+        m_sync_cond.wait_for(lock, boost::chrono::seconds(1));
+        continue;
+      }
+      lock.unlock();
+      try
+      {
+        process_queued_spans();
+      }
+      catch (const std::exception &e)
+      {
+        LOG_ERROR("Exception while adding queued blocks: " << e.what());
+      }
+      lock.lock();
+    }
+    LOG_PRINT_L1("Block sync thread stopped");
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  void t_cryptonote_protocol_handler<t_core>::wake_sync_thread()
+  {
+    // taking the lock makes sure the sync thread is either waiting or has
+    // yet to check the queue, so the notification cannot get lost
+    {
+      boost::lock_guard<boost::mutex> lock(m_sync_lock);
+    }
+    m_sync_cond.notify_one();
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  bool t_cryptonote_protocol_handler<t_core>::process_queued_spans()
+  {
+    bool processed = false;
+    block_queue::span span(0, 0, boost::uuids::uuid(), boost::posix_time::ptime());
+    while (!m_stopping && m_block_queue.get_next_span(m_core.get_current_blockchain_height(), span))
+    {
+      processed = true;
+      const bool r = add_span_blocks(span);
+      m_block_queue.remove_span(span.start_block_height);
+      if (!r)
+        break;
+    }
 
-        uint64_t previous_height = m_core.get_current_blockchain_height();
+    if (processed)
+      request_idle_connections();
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  bool t_cryptonote_protocol_handler<t_core>::add_span_blocks(const block_queue::span& span)
+  {
+    m_core.pause_mine();
+    epee::misc_utils::auto_scope_leave_caller scope_exit_handler = epee::misc_utils::create_scope_leave_handler(
+      boost::bind(&t_core::resume_mine, &m_core));
 
-        m_core.prepare_handle_incoming_blocks(arg.blocks);
-        BOOST_FOREACH(const block_complete_entry& block_entry, arg.blocks)
-        {
-          if (m_stopping)
-          {
-              m_core.cleanup_handle_incoming_blocks();
-              return 1;
-          }
+    uint64_t previous_height = m_core.get_current_blockchain_height();
 
-          // process transactions
-          TIME_MEASURE_START(transactions_process_time);
-          BOOST_FOREACH(auto& tx_blob, block_entry.txs)
-          {
-            tx_verification_context tvc = AUTO_VAL_INIT(tvc);
-            m_core.handle_incoming_tx(tx_blob, tvc, true, true);
-            if(tvc.m_verifivation_failed)
-            {
-              LOG_ERROR_CCONTEXT("transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
-                  << epee::string_tools::pod_to_hex(get_blob_hash(tx_blob)) << ", dropping connection");
-              m_p2p->drop_connection(context);
-              m_core.cleanup_handle_incoming_blocks();
-              return 1;
-            }
-          }
-          TIME_MEASURE_FINISH(transactions_process_time);
+    std::vector<block> pblocks;
+    m_core.prepare_handle_incoming_blocks(span.blocks, pblocks);
+    size_t block_index = 0;
+    BOOST_FOREACH(const block_complete_entry& block_entry, span.blocks)
+    {
+      // blocks which failed to parse in prepare are parsed, and rejected, again
+      const block *pblock = block_index < pblocks.size() ? &pblocks[block_index] : NULL;
+      ++block_index;
 
-          // process block
+      if (m_stopping)
+      {
+          m_core.cleanup_handle_incoming_blocks();
+          return false;
+      }
 
-          TIME_MEASURE_START(block_process_time);
-          block_verification_context bvc = boost::value_initialized<block_verification_context>();
+      // process transactions
+      TIME_MEASURE_START(transactions_process_time);
+      BOOST_FOREACH(auto& tx_blob, block_entry.txs)
+      {
+        tx_verification_context tvc = AUTO_VAL_INIT(tvc);
+        m_core.handle_incoming_tx(tx_blob, tvc, true, true);
+        if(tvc.m_verifivation_failed)
+        {
+          LOG_ERROR("transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
+              << epee::string_tools::pod_to_hex(get_blob_hash(tx_blob)) << ", dropping connection");
+          drop_connection(span.connection_id, false);
+          m_core.cleanup_handle_incoming_blocks();
+          return false;
+        }
+      }
+      TIME_MEASURE_FINISH(transactions_process_time);
 
-          m_core.handle_incoming_block(block_entry.block, bvc, false); // <--- process block
-          if(bvc.m_system_time_incorrect)
-          {
-           LOG_PRINT_CCONTEXT_L1("Block verification failed, time incorrect");
-            m_core.cleanup_handle_incoming_blocks();
-            return 1;
-          }
-          if(bvc.m_verifivation_failed)
-          {
-            LOG_PRINT_CCONTEXT_L1("Block verification failed, dropping connection");
-            m_p2p->drop_connection(context);
-            m_p2p->add_ip_fail(context.m_remote_ip);
-            m_core.cleanup_handle_incoming_blocks();
-            return 1;
-          }
-          if(bvc.m_marked_as_orphaned)
-          {
-            LOG_PRINT_CCONTEXT_L1("Block received at sync phase was marked as orphaned, dropping connection");
-            m_p2p->drop_connection(context);
-            m_p2p->add_ip_fail(context.m_remote_ip);
-            m_core.cleanup_handle_incoming_blocks();
-            return 1;
-          }
+      // process block
 
-          TIME_MEASURE_FINISH(block_process_time);
-          LOG_PRINT_CCONTEXT_L2("Block process time: " << block_process_time + transactions_process_time << "(" << transactions_process_time << "/" << block_process_time << ")ms");
+      TIME_MEASURE_START(block_process_time);
+      block_verification_context bvc = boost::value_initialized<block_verification_context>();
 
-        } // each download block
+      m_core.handle_incoming_block(block_entry.block, pblock, bvc, false); // <--- process block
+      if(bvc.m_system_time_incorrect)
+      {
+        LOG_PRINT_L1("Block verification failed, time incorrect");
+        m_core.cleanup_handle_incoming_blocks();
+        return false;
+      }
+      if(bvc.m_verifivation_failed)
+      {
+        LOG_PRINT_L1("Block verification failed, dropping connection");
+        drop_connection(span.connection_id, true);
+        m_core.cleanup_handle_incoming_blocks();
+        return false;
+      }
+      if(bvc.m_marked_as_orphaned)
+      {
+        LOG_PRINT_L1("Block received at sync phase was marked as orphaned, dropping connection");
+        drop_connection(span.connection_id, true);
         m_core.cleanup_handle_incoming_blocks();
+        return false;
+      }
 
-        if (m_core.get_current_blockchain_height() > previous_height)
-        {
-          LOG_PRINT_CCONTEXT_YELLOW( "Synced " << m_core.get_current_blockchain_height() << "/" << m_core.get_target_blockchain_height() , LOG_LEVEL_0);
-        }
-      } // if not DISCARD BLOCK
+      TIME_MEASURE_FINISH(block_process_time);
+      LOG_PRINT_L2("Block process time: " << block_process_time + transactions_process_time << "(" << transactions_process_time << "/" << block_process_time << ")ms");
 
+    } // each download block
+    m_core.cleanup_handle_incoming_blocks();
 
+    if (m_core.get_current_blockchain_height() > previous_height)
+    {
+      LOG_PRINT_YELLOW( "Synced " << m_core.get_current_blockchain_height() << "/" << m_core.get_target_blockchain_height()
+        << " (" << m_block_queue.get_num_spans() << " spans, " << m_block_queue.get_data_size() / 1024 << " kB queued)", LOG_LEVEL_0);
     }
-    request_missing_objects(context, true);
-    return 1;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  bool t_cryptonote_protocol_handler<t_core>::request_idle_connections()
+  {
+    // connections which found nothing to reserve wait until spans free up
+    m_p2p->for_each_connection([&](cryptonote_connection_context& context, nodetool::peerid_type peer_id, uint32_t support_flags)->bool{
+      if (context.m_state == cryptonote_connection_context::state_synchronizing && context.m_needed_objects.size()
+          && context.m_requested_objects.empty() && context.m_callback_request_count == 0)
+      {
+        ++context.m_callback_request_count;
+        m_p2p->request_callback(context);
+      }
+      return true;
+    });
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  void t_cryptonote_protocol_handler<t_core>::drop_connection(const boost::uuids::uuid& connection_id, bool add_fail)
+  {
+    m_block_queue.flush_spans(connection_id, true);
+    m_p2p->for_each_connection([&](cryptonote_connection_context& context, nodetool::peerid_type peer_id, uint32_t support_flags)->bool{
+      if (context.m_connection_id != connection_id)
+        return true;
+      m_p2p->drop_connection(context);
+      if (add_fail)
+        m_p2p->add_ip_fail(context.m_remote_ip);
+      return false;
+    });
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::on_idle()
   {
+    relay_pending_transactions();
+    m_idle_connections_interval.do_call(boost::bind(&t_cryptonote_protocol_handler<t_core>::request_idle_connections, this));
     return m_core.on_idle();
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -967,7 +1164,7 @@ namespace cryptonote
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
-  bool t_cryptonote_protocol_handler<t_core>::request_missing_objects(cryptonote_connection_context& context, bool check_having_blocks)
+  bool t_cryptonote_protocol_handler<t_core>::request_missing_objects(cryptonote_connection_context& context)
   {
     //if (!m_one_request == false)
       //return true;
@@ -978,27 +1175,40 @@ namespace cryptonote
       auto time_from_epoh = point.time_since_epoch();
       auto sec = duration_cast< seconds >( time_from_epoh ).count();*/
 
-    if(context.m_needed_objects.size())
+    // forget about what got into the chain since we learnt about it
+    const uint64_t height = m_core.get_current_blockchain_height();
+    uint64_t first_needed = context.m_last_response_height + 1 - context.m_needed_objects.size();
+    while(context.m_needed_objects.size() && first_needed < height)
     {
-      //we know objects that we need, request this objects
-      NOTIFY_REQUEST_GET_OBJECTS::request req;
-      size_t count = 0;
-      auto it = context.m_needed_objects.begin();
+      context.m_needed_objects.pop_front();
+      ++first_needed;
+    }
 
+    if(context.m_needed_objects.size())
+    {
+      //we know objects that we need, request a span of them nobody else is downloading
       const size_t count_limit = m_core.get_block_sync_size();
       _note_c("net/req-calc" , "Setting count_limit: " << count_limit);
-      while(it != context.m_needed_objects.end() && count < count_limit)
+      // with the queue full, only fetch what the chain needs next
+      const uint64_t max_span_start = m_block_queue.get_data_size() > BLOCK_QUEUE_MAX_SIZE ? height : std::numeric_limits<uint64_t>::max();
+      uint64_t span_start, span_length;
+      if(!m_block_queue.reserve_span(first_needed, context.m_last_response_height, count_limit, max_span_start, context.m_connection_id, span_start, span_length))
       {
-        if( !(check_having_blocks && m_core.have_block(*it)))
-        {
-          req.blocks.push_back(*it);
-          ++count;
-          context.m_requested_objects.insert(*it);
-        }
-        context.m_needed_objects.erase(it++);
+        LOG_PRINT_CCONTEXT_L2("all blocks this peer has for us are being downloaded already, waiting");
+        return true;
+      }
+
+      NOTIFY_REQUEST_GET_OBJECTS::request req;
+      auto it = context.m_needed_objects.begin();
+      std::advance(it, span_start - first_needed);
+      for(uint64_t n = 0; n < span_length; ++n, ++it)
+      {
+        req.blocks.push_back(*it);
+        context.m_requested_objects.insert(*it);
       }
+      context.m_expect_height = span_start;
       LOG_PRINT_CCONTEXT_L1("-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size()
-          << "requested blocks count=" << count << " / " << count_limit);
+          << "requested blocks count=" << span_length << " / " << count_limit << " from height " << span_start);
       //epee::net_utils::network_throttle_manager::get_global_throttle_inreq().logger_handle_net("log/dr-Bixbite/net/req-all.data", sec, get_avg_block_size());
 
       post_notify<NOTIFY_REQUEST_GET_OBJECTS>(req, context);
@@ -1098,13 +1308,15 @@ namespace cryptonote
       m_p2p->drop_connection(context);
     }
 
-    BOOST_FOREACH(auto& bl_id, arg.m_block_ids)
-    {
-      if(!m_core.have_block(bl_id))
-        context.m_needed_objects.push_back(bl_id);
-    }
+    // m_needed_objects ends at m_last_response_height, so the heights of the
+    // ids follow from their position
+    context.m_needed_objects.clear();
+    auto bl_it = arg.m_block_ids.begin();
+    while(bl_it != arg.m_block_ids.end() && m_core.have_block(*bl_it))
+      ++bl_it;
+    context.m_needed_objects.assign(bl_it, arg.m_block_ids.end());
 
-    request_missing_objects(context, false);
+    request_missing_objects(context);
     return 1;
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -1129,7 +1341,7 @@ namespace cryptonote
     {
       if (peer_id && exclude_context.m_connection_id != context.m_connection_id)
       {
-        if (m_core.get_testnet() && (support_flags & P2P_SUPPORT_FLAG_FLUFFY_BLOCKS))
+        if (support_flags & P2P_SUPPORT_FLAG_FLUFFY_BLOCKS)
         {
           LOG_PRINT_CCONTEXT_YELLOW("PEER SUPPORTS FLUFFY BLOCKS - RELAYING THIN/COMPACT WHATEVER BLOCK", LOG_LEVEL_2);
           fluffyConnections.push_back(context.m_connection_id);
@@ -1153,10 +1365,103 @@ namespace cryptonote
   template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg, cryptonote_connection_context& exclude_context)
   {
-    // no check for success, so tell core they're relayed unconditionally
-    for(auto tx_blob_it = arg.txs.begin(); tx_blob_it!=arg.txs.end(); ++tx_blob_it)
-      m_core.on_transaction_relayed(*tx_blob_it);
-    return relay_post_notify<NOTIFY_NEW_TRANSACTIONS>(arg, exclude_context);
+    // callers tell core the txs are relayed, they have the hashes already.
+    // The txs are only queued here for the peers which do not know them
+    // yet, relay_pending_transactions sends them in batches
+    std::list<boost::uuids::uuid> connections;
+    m_p2p->for_each_connection([&](cryptonote_connection_context& context, nodetool::peerid_type peer_id, uint32_t support_flags)->bool{
+      if (peer_id && exclude_context.m_connection_id != context.m_connection_id)
+        connections.push_back(context.m_connection_id);
+      return true;
+    });
+
+    // keyed by blob hash, which needs no parsing and is as unique as the tx hash
+    std::list<std::pair<crypto::hash, std::shared_ptr<const blobdata>>> txs;
+    for (const blobdata& tx_blob: arg.txs)
+      txs.push_back(std::make_pair(get_blob_hash(tx_blob), std::make_shared<const blobdata>(tx_blob)));
+
+    uint64_t saved = 0;
+    boost::lock_guard<boost::mutex> lock(m_tx_relay_lock);
+    for (const boost::uuids::uuid& connection_id: connections)
+    {
+      tx_relay_peer& peer = m_tx_relay_peers[connection_id];
+      if (peer.known_txs.size() + txs.size() > CRYPTONOTE_PROTOCOL_MAX_KNOWN_TXS)
+        peer.known_txs.clear();
+      for (const auto& tx: txs)
+      {
+        if (peer.known_txs.insert(tx.first).second)
+          peer.pending_txs.push_back(tx.second);
+        else
+          saved += tx.second->size();
+      }
+    }
+    m_tx_relay_bytes_saved += saved;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  void t_cryptonote_protocol_handler<t_core>::add_known_transactions(const boost::uuids::uuid& connection_id, const std::list<blobdata>& txs)
+  {
+    boost::lock_guard<boost::mutex> lock(m_tx_relay_lock);
+    tx_relay_peer& peer = m_tx_relay_peers[connection_id];
+    if (peer.known_txs.size() + txs.size() > CRYPTONOTE_PROTOCOL_MAX_KNOWN_TXS)
+      peer.known_txs.clear();
+    for (const blobdata& tx_blob: txs)
+      peer.known_txs.insert(get_blob_hash(tx_blob));
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  bool t_cryptonote_protocol_handler<t_core>::relay_pending_transactions()
+  {
+    std::set<boost::uuids::uuid> connections;
+    m_p2p->for_each_connection([&](cryptonote_connection_context& context, nodetool::peerid_type peer_id, uint32_t support_flags)->bool{
+      connections.insert(context.m_connection_id);
+      return true;
+    });
+
+    const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+    std::list<std::pair<boost::uuids::uuid, std::string>> batches;
+    size_t ntxs = 0;
+    {
+      boost::lock_guard<boost::mutex> lock(m_tx_relay_lock);
+      for (auto i = m_tx_relay_peers.begin(); i != m_tx_relay_peers.end(); )
+      {
+        if (connections.find(i->first) == connections.end())
+        {
+          m_tx_relay_peers.erase(i++);
+          continue;
+        }
+
+        // each peer gets its batches on its own timer, exponentially
+        // distributed so relay timing says little about where a tx came from
+        tx_relay_peer& peer = i->second;
+        const bool first = peer.next_relay_time.is_not_a_date_time();
+        if (first || (!peer.pending_txs.empty() && peer.next_relay_time <= now))
+        {
+          const double u = (crypto::rand<uint32_t>() + 1.0) / 4294967297.0;
+          const double delay = std::min(-std::log(u), 4.0) * CRYPTONOTE_PROTOCOL_TX_TRICKLE_INTERVAL;
+          peer.next_relay_time = now + boost::posix_time::milliseconds((int64_t)(delay * 1000));
+          if (!first)
+          {
+            NOTIFY_NEW_TRANSACTIONS::request req;
+            for (const auto& tx: peer.pending_txs)
+              req.txs.push_back(*tx);
+            ntxs += req.txs.size();
+            peer.pending_txs.clear();
+            batches.push_back(std::make_pair(i->first, std::string()));
+            epee::serialization::store_t_to_binary(req, batches.back().second);
+          }
+        }
+        ++i;
+      }
+    }
+
+    for (const auto& batch: batches)
+      m_p2p->relay_notify_to_list(NOTIFY_NEW_TRANSACTIONS::ID, batch.second, std::list<boost::uuids::uuid>(1, batch.first));
+    if (!batches.empty())
+      LOG_PRINT_L2("Relayed " << ntxs << " txs to " << batches.size() << " peers, "
+          << m_tx_relay_bytes_saved / 1024 << " kB of txs peers already had not sent so far");
+    return true;
   }
 
   /// @deprecated
@@ -1176,6 +1481,7 @@ namespace cryptonote
   void t_cryptonote_protocol_handler<t_core>::stop()
   {
     m_stopping = true;
+    wake_sync_thread();
     m_core.stop();
   }
 } // namespace
@@ -91,6 +91,8 @@ namespace nodetool
     m_hide_my_port(false),
     m_no_igd(false),
     m_offline(false),
+    m_io_shards(0),
+    m_peerlist_journal_size(0),
     m_save_graph(false),
     is_closing(false),
     m_net_server( epee::net_utils::e_connection_type_P2P ) // this is a P2P connection of the main p2p node server, because this is class node_server<>
@@ -166,6 +168,8 @@ namespace nodetool
     bool init_config();
     bool make_default_config();
     bool store_config();
+    bool load_peerlist_journal();
+    bool store_peerlist_journal();
     bool check_trust(const proof_of_trust& tr);
 
 
@@ -277,6 +281,7 @@ namespace nodetool
     bool m_hide_my_port;
     bool m_no_igd;
     bool m_offline;
+    uint32_t m_io_shards;
     std::atomic<bool> m_save_graph;
     std::atomic<bool> is_closing;
     std::unique_ptr<boost::thread> mPeersLoggerThread;
@@ -289,6 +294,8 @@ namespace nodetool
     epee::math_helper::once_a_time_seconds<P2P_DEFAULT_HANDSHAKE_INTERVAL> m_peer_handshake_idle_maker_interval;
     epee::math_helper::once_a_time_seconds<1> m_connections_maker_interval;
     epee::math_helper::once_a_time_seconds<60*30, false> m_peerlist_store_interval;
+    epee::math_helper::once_a_time_seconds<60, false> m_peerlist_journal_interval;
+    size_t m_peerlist_journal_size;
 
     std::string m_bind_ip;
     std::string m_port;
@@ -94,6 +94,7 @@ namespace nodetool
     const command_line::arg_descriptor<bool>        arg_offline = {"offline", "Do not listen for peers, nor connect to any"};
     const command_line::arg_descriptor<int64_t>     arg_out_peers = {"out-peers", "set max number of out peers", -1};
     const command_line::arg_descriptor<int> arg_tos_flag = {"tos-flag", "set TOS flag", -1};
+    const command_line::arg_descriptor<uint32_t> arg_p2p_io_shards = {"p2p-io-shards", "Spread p2p connections over this many network threads, each with its own event loop (0 to share one loop)", 0};
 
     const command_line::arg_descriptor<int64_t> arg_limit_rate_up = {"limit-rate-up", "set limit-rate-up [kB/s]", -1};
     const command_line::arg_descriptor<int64_t> arg_limit_rate_down = {"limit-rate-down", "set limit-rate-down [kB/s]", -1};
@@ -119,6 +120,7 @@ namespace nodetool
     command_line::add_arg(desc, arg_offline);
     command_line::add_arg(desc, arg_out_peers);
     command_line::add_arg(desc, arg_tos_flag);
+    command_line::add_arg(desc, arg_p2p_io_shards);
     command_line::add_arg(desc, arg_limit_rate_up);
     command_line::add_arg(desc, arg_limit_rate_down);
     command_line::add_arg(desc, arg_limit_rate);
@@ -287,6 +289,7 @@ namespace nodetool
     m_allow_local_ip = command_line::get_arg(vm, arg_p2p_allow_local_ip);
     m_no_igd = command_line::get_arg(vm, arg_no_igd);
     m_offline = command_line::get_arg(vm, arg_offline);
+    m_io_shards = command_line::get_arg(vm, arg_p2p_io_shards);
 
     if (command_line::has_arg(vm, arg_p2p_add_peer))
     {
@@ -504,6 +507,9 @@ namespace nodetool
     res = m_peerlist.init(m_allow_local_ip);
     CHECK_AND_ASSERT_MES(res, false, "Failed to init peerlist.");
 
+    res = load_peerlist_journal();
+    CHECK_AND_ASSERT_MES(res, false, "Failed to load peerlist journal.");
+
 
     for(auto& p: m_command_line_peers)
       m_peerlist.append_with_peer_white(p);
@@ -518,6 +524,11 @@ namespace nodetool
     m_net_server.get_config_object().m_pcommands_handler = this;
     m_net_server.get_config_object().m_invoke_timeout = P2P_DEFAULT_INVOKE_TIMEOUT;
     m_net_server.set_connection_filter(this);
+    if (m_io_shards)
+    {
+      LOG_PRINT_L0("Spreading p2p connections over " << m_io_shards << " network threads");
+      m_net_server.set_io_service_shards(m_io_shards);
+    }
 
     // from here onwards, it's online stuff
     if (m_offline)
@@ -655,17 +666,35 @@ namespace nodetool
       return false;
     }
 
+    // everything journaled so far is in the full state
+    std::vector<peerlist_journal_entry> journal;
+    m_peerlist.take_journal(journal);
+
+    // written next to the old state and moved over it, so a crash never leaves a truncated file
     std::string state_file_path = m_config_folder + "/" + P2P_NET_DATA_FILENAME;
-    std::ofstream p2p_data;
-    p2p_data.open( state_file_path , std::ios_base::binary | std::ios_base::out| std::ios::trunc);
-    if(p2p_data.fail())
+    std::string tmp_file_path = state_file_path + ".tmp";
     {
-      LOG_PRINT_L0("Failed to save config to file " << state_file_path);
+      std::ofstream p2p_data;
+      p2p_data.open( tmp_file_path , std::ios_base::binary | std::ios_base::out| std::ios::trunc);
+      if(p2p_data.fail())
+      {
+        LOG_PRINT_L0("Failed to save config to file " << tmp_file_path);
+        return false;
+      };
+
+      boost::archive::portable_binary_oarchive a(p2p_data);
+      a << *this;
+    }
+    std::error_code e = tools::replace_file(tmp_file_path, state_file_path);
+    if (e)
+    {
+      LOG_PRINT_L0("Failed to replace " << state_file_path << ": " << e.message());
       return false;
-    };
+    }
 
-    boost::archive::portable_binary_oarchive a(p2p_data);
-    a << *this;
+    boost::system::error_code ec;
+    boost::filesystem::remove(m_config_folder + "/" + P2P_NET_JOURNAL_FILENAME, ec);
+    m_peerlist_journal_size = 0;
     return true;
     CATCH_ENTRY_L0("blockchain_storage::save", false);
 
@@ -673,6 +702,77 @@ namespace nodetool
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::load_peerlist_journal()
+  {
+    TRY_ENTRY();
+    std::string journal_file_path = m_config_folder + "/" + P2P_NET_JOURNAL_FILENAME;
+    size_t count = 0;
+    {
+      std::ifstream journal;
+      journal.open(journal_file_path, std::ios_base::binary | std::ios_base::in);
+      if(journal.fail())
+        return true;
+
+      while(journal.peek() != std::ifstream::traits_type::eof())
+      {
+        std::vector<peerlist_journal_entry> entries;
+        try
+        {
+          boost::archive::portable_binary_iarchive a(journal);
+          a >> entries;
+        }
+        catch (...)
+        {
+          LOG_PRINT_L0("Ignoring the incomplete end of the peerlist journal");
+          break;
+        }
+        m_peerlist.apply_journal(entries);
+        count += entries.size();
+      }
+    }
+    LOG_PRINT_L1("Applied " << count << " peerlist changes from the journal");
+
+    // compacted right away, anything appended after an incomplete batch could not be read back
+    return store_config();
+    CATCH_ENTRY_L0("node_server::load_peerlist_journal", false);
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::store_peerlist_journal()
+  {
+    TRY_ENTRY();
+    std::vector<peerlist_journal_entry> entries;
+    m_peerlist.take_journal(entries);
+    if(entries.empty())
+      return true;
+
+    // rewrite the full state instead once the journal outgrows the peerlist
+    m_peerlist_journal_size += entries.size();
+    if(m_peerlist_journal_size > m_peerlist.get_white_peers_count() + m_peerlist.get_gray_peers_count())
+      return store_config();
+
+    if (!tools::create_directories_if_necessary(m_config_folder))
+    {
+      LOG_PRINT_L0("Failed to create data directory: " << m_config_folder);
+      return false;
+    }
+
+    std::string journal_file_path = m_config_folder + "/" + P2P_NET_JOURNAL_FILENAME;
+    std::ofstream journal;
+    journal.open(journal_file_path, std::ios_base::binary | std::ios_base::out | std::ios_base::app);
+    if(journal.fail())
+    {
+      LOG_PRINT_L0("Failed to append to " << journal_file_path);
+      return false;
+    }
+
+    boost::archive::portable_binary_oarchive a(journal);
+    a << entries;
+    return true;
+    CATCH_ENTRY_L0("node_server::store_peerlist_journal", false);
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::send_stop_signal()
   {
     m_payload_handler.stop();
@@ -1098,6 +1198,7 @@ namespace nodetool
     m_peer_handshake_idle_maker_interval.do_call(boost::bind(&node_server<t_payload_net_handler>::peer_sync_idle_maker, this));
     m_connections_maker_interval.do_call(boost::bind(&node_server<t_payload_net_handler>::connections_maker, this));
     m_peerlist_store_interval.do_call(boost::bind(&node_server<t_payload_net_handler>::store_config, this));
+    m_peerlist_journal_interval.do_call(boost::bind(&node_server<t_payload_net_handler>::store_peerlist_journal, this));
     return true;
   }
   //-----------------------------------------------------------------------------------
@@ -1266,9 +1367,11 @@ namespace nodetool
   template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::relay_notify_to_list(int command, const std::string& data_buff, const std::list<boost::uuids::uuid> &connections)
   {
+    // built once, every connection queues a reference to the same bytes
+    const epee::net_utils::shared_buffer message = epee::levin::make_notify(command, data_buff);
     BOOST_FOREACH(const auto& c_id, connections)
     {
-      m_net_server.get_config_object().notify(command, data_buff, c_id);
+      m_net_server.get_config_object().send(message, c_id);
     }
     return true;
   }
@@ -1531,6 +1634,9 @@ namespace nodetool
         << std::endl;
       return true;
     });
+    const auto shards = m_net_server.get_io_shard_stats();
+    for (size_t i = 0; i < shards.size(); ++i)
+      ss << "shard " << i << ": " << shards[i].connections << " connections, " << shards[i].total_connections << " total" << std::endl;
     std::string s = ss.str();
     return s;
   }
@@ -1545,6 +1651,7 @@ namespace nodetool
   void node_server<t_payload_net_handler>::on_connection_close(p2p_connection_context& context)
   {
     LOG_PRINT_L2("["<< epee::net_utils::print_connection_context(context) << "] CLOSE CONNECTION");
+    m_payload_handler.on_connection_close(context);
   }
 
   template<class t_payload_net_handler>
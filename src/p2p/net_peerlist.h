@@ -34,7 +34,11 @@
 #include <list>
 #include <set>
 #include <map>
+#include <vector>
+#include <atomic>
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 //#include <boost/bimap.hpp>
 //#include <boost/bimap/multiset_of.hpp>
 #include <boost/archive/binary_oarchive.hpp>
@@ -42,6 +46,7 @@
 #include <boost/archive/portable_binary_oarchive.hpp>
 #include <boost/archive/portable_binary_iarchive.hpp>
 #include <boost/serialization/version.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -61,6 +66,12 @@
 namespace nodetool
 {
 
+  /** a change to the peerlist since it was last stored in full */
+  struct peerlist_journal_entry
+  {
+    bool white;
+    peerlist_entry entry;
+  };
 
   /************************************************************************/
   /*                                                                      */
@@ -68,10 +79,13 @@ namespace nodetool
   class peerlist_manager
   {
   public: 
+    peerlist_manager(): m_allow_local_ip(false), m_snapshots_dirty(true) {}
+    peerlist_manager& operator=(const peerlist_manager& pm);
+
     bool init(bool allow_local_ip);
     bool deinit();
-    size_t get_white_peers_count(){CRITICAL_REGION_LOCAL(m_peerlist_lock); return m_peers_white.size();}
-    size_t get_gray_peers_count(){CRITICAL_REGION_LOCAL(m_peerlist_lock); return m_peers_gray.size();}
+    size_t get_white_peers_count(){return get_white_snapshot()->size();}
+    size_t get_gray_peers_count(){return get_gray_snapshot()->size();}
     bool merge_peerlist(const std::list<peerlist_entry>& outer_bs);
     bool get_peerlist_head(std::list<peerlist_entry>& bs_head, uint32_t depth = P2P_DEFAULT_PEERS_IN_HANDSHAKE);
     bool get_peerlist_full(std::list<peerlist_entry>& pl_gray, std::list<peerlist_entry>& pl_white);
@@ -84,6 +98,23 @@ namespace nodetool
     bool set_peer_unreachable(const peerlist_entry& pr);
     bool is_ip_allowed(uint32_t ip);
 
+    /**
+     * @brief takes the changes made since the last call
+     *
+     * Only the last change to each address is kept, so the journal is at
+     * most as large as the peerlist itself.
+     *
+     * @param entries return-by-reference the changes, appended to
+     */
+    void take_journal(std::vector<peerlist_journal_entry>& entries);
+
+    /**
+     * @brief applies changes taken with take_journal, without journaling them again
+     *
+     * @param entries the changes, in the order they were taken
+     */
+    void apply_journal(const std::vector<peerlist_journal_entry>& entries);
+
     
   private:
     struct by_time{};
@@ -153,6 +184,7 @@ namespace nodetool
       if(ver < 3)
         return;
       CRITICAL_REGION_LOCAL(m_peerlist_lock);
+      m_snapshots_dirty = true;
       if(ver < 4)
       {
         //loading data from old storage
@@ -166,9 +198,17 @@ namespace nodetool
     }
 
   private: 
+    /** the white or gray list, newest first, shared with readers without holding m_peerlist_lock */
+    typedef boost::shared_ptr<const std::vector<peerlist_entry> > peers_snapshot;
+
     bool peers_indexed_from_old(const peers_indexed_old& pio, peers_indexed& pi);
     void trim_white_peerlist();
     void trim_gray_peerlist();
+    void add_to_journal(bool white, const peerlist_entry& ple);
+    peers_snapshot get_white_snapshot();
+    peers_snapshot get_gray_snapshot();
+    void update_snapshots();
+    static peers_snapshot make_snapshot(peers_indexed& peers);
 
     friend class boost::serialization::access;
     epee::critical_section m_peerlist_lock;
@@ -178,9 +218,28 @@ namespace nodetool
 
     peers_indexed m_peers_gray;
     peers_indexed m_peers_white;
+
+    std::map<net_address, peerlist_journal_entry> m_journal;
+
+    std::atomic<bool> m_snapshots_dirty;
+    peers_snapshot m_white_snapshot;
+    peers_snapshot m_gray_snapshot;
   };
   //--------------------------------------------------------------------------------------------------
   inline
+  peerlist_manager& peerlist_manager::operator=(const peerlist_manager& pm)
+  {
+    CRITICAL_REGION_LOCAL(m_peerlist_lock);
+    m_config_folder = pm.m_config_folder;
+    m_allow_local_ip = pm.m_allow_local_ip;
+    m_peers_gray = pm.m_peers_gray;
+    m_peers_white = pm.m_peers_white;
+    m_journal = pm.m_journal;
+    m_snapshots_dirty = true;
+    return *this;
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
   bool peerlist_manager::init(bool allow_local_ip)
   {
     m_allow_local_ip = allow_local_ip;
@@ -242,24 +301,22 @@ namespace nodetool
   inline
   bool peerlist_manager::get_white_peer_by_index(peerlist_entry& p, size_t i)
   {
-    CRITICAL_REGION_LOCAL(m_peerlist_lock);
-    if(i >= m_peers_white.size())
+    const peers_snapshot peers = get_white_snapshot();
+    if(i >= peers->size())
       return false;
 
-    peers_indexed::index<by_time>::type& by_time_index = m_peers_white.get<by_time>();
-    p = *epee::misc_utils::move_it_backward(--by_time_index.end(), i);    
+    p = (*peers)[i];
     return true;
   }
   //--------------------------------------------------------------------------------------------------
   inline
     bool peerlist_manager::get_gray_peer_by_index(peerlist_entry& p, size_t i)
   {
-    CRITICAL_REGION_LOCAL(m_peerlist_lock);
-    if(i >= m_peers_gray.size())
+    const peers_snapshot peers = get_gray_snapshot();
+    if(i >= peers->size())
       return false;
 
-    peers_indexed::index<by_time>::type& by_time_index = m_peers_gray.get<by_time>();
-    p = *epee::misc_utils::move_it_backward(--by_time_index.end(), i);    
+    p = (*peers)[i];
     return true;
   }
   //--------------------------------------------------------------------------------------------------
@@ -279,11 +336,9 @@ namespace nodetool
   inline 
   bool peerlist_manager::get_peerlist_head(std::list<peerlist_entry>& bs_head, uint32_t depth)
   {
-    
-    CRITICAL_REGION_LOCAL(m_peerlist_lock);
-    peers_indexed::index<by_time>::type& by_time_index=m_peers_white.get<by_time>();
+    const peers_snapshot peers = get_white_snapshot();
     uint32_t cnt = 0;
-    BOOST_REVERSE_FOREACH(const peers_indexed::value_type& vl, by_time_index)
+    BOOST_FOREACH(const peerlist_entry& vl, *peers)
     {
       if(!vl.last_seen)
         continue;
@@ -297,18 +352,11 @@ namespace nodetool
   inline
   bool peerlist_manager::get_peerlist_full(std::list<peerlist_entry>& pl_gray, std::list<peerlist_entry>& pl_white)
   {    
-    CRITICAL_REGION_LOCAL(m_peerlist_lock);
-    peers_indexed::index<by_time>::type& by_time_index_gr=m_peers_gray.get<by_time>();
-    BOOST_REVERSE_FOREACH(const peers_indexed::value_type& vl, by_time_index_gr)
-    {
-      pl_gray.push_back(vl);      
-    }
+    const peers_snapshot gray = get_gray_snapshot();
+    pl_gray.insert(pl_gray.end(), gray->begin(), gray->end());
 
-    peers_indexed::index<by_time>::type& by_time_index_wt=m_peers_white.get<by_time>();
-    BOOST_REVERSE_FOREACH(const peers_indexed::value_type& vl, by_time_index_wt)
-    {
-      pl_white.push_back(vl);      
-    }
+    const peers_snapshot white = get_white_snapshot();
+    pl_white.insert(pl_white.end(), white->begin(), white->end());
 
     return true;
   }
@@ -362,6 +410,8 @@ namespace nodetool
     {
       m_peers_gray.erase(by_addr_it_gr);
     }
+    add_to_journal(true, ple);
+    m_snapshots_dirty = true;
     return true;
     CATCH_ENTRY_L0("peerlist_manager::append_with_peer_white()", false);
   }
@@ -391,11 +441,85 @@ namespace nodetool
       //update record in white list 
       m_peers_gray.replace(by_addr_it_gr, ple);      
     }
+    add_to_journal(false, ple);
+    m_snapshots_dirty = true;
     return true;
     CATCH_ENTRY_L0("peerlist_manager::append_with_peer_gray()", false);
     return true;
   }
   //--------------------------------------------------------------------------------------------------
+  inline
+  void peerlist_manager::add_to_journal(bool white, const peerlist_entry& ple)
+  {
+    CRITICAL_REGION_LOCAL(m_peerlist_lock);
+    // a gray entry does not demote a peer which was made white since the last take
+    auto it = m_journal.find(ple.adr);
+    if(!white && it != m_journal.end() && it->second.white)
+      return;
+    m_journal[ple.adr] = peerlist_journal_entry{white, ple};
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  void peerlist_manager::take_journal(std::vector<peerlist_journal_entry>& entries)
+  {
+    CRITICAL_REGION_LOCAL(m_peerlist_lock);
+    entries.reserve(entries.size() + m_journal.size());
+    for(const auto& e: m_journal)
+      entries.push_back(e.second);
+    m_journal.clear();
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  void peerlist_manager::apply_journal(const std::vector<peerlist_journal_entry>& entries)
+  {
+    CRITICAL_REGION_LOCAL(m_peerlist_lock);
+    for(const peerlist_journal_entry& e: entries)
+    {
+      if(e.white)
+        append_with_peer_white(e.entry);
+      else
+        append_with_peer_gray(e.entry);
+    }
+    m_journal.clear();
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  peerlist_manager::peers_snapshot peerlist_manager::make_snapshot(peers_indexed& peers)
+  {
+    boost::shared_ptr<std::vector<peerlist_entry> > snapshot = boost::make_shared<std::vector<peerlist_entry> >();
+    snapshot->reserve(peers.size());
+    peers_indexed::index<by_time>::type& by_time_index = peers.get<by_time>();
+    snapshot->assign(by_time_index.rbegin(), by_time_index.rend());
+    return snapshot;
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  void peerlist_manager::update_snapshots()
+  {
+    CRITICAL_REGION_LOCAL(m_peerlist_lock);
+    if(!m_snapshots_dirty)
+      return;
+    m_snapshots_dirty = false;
+    boost::atomic_store(&m_white_snapshot, make_snapshot(m_peers_white));
+    boost::atomic_store(&m_gray_snapshot, make_snapshot(m_peers_gray));
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  peerlist_manager::peers_snapshot peerlist_manager::get_white_snapshot()
+  {
+    if(m_snapshots_dirty)
+      update_snapshots();
+    return boost::atomic_load(&m_white_snapshot);
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  peerlist_manager::peers_snapshot peerlist_manager::get_gray_snapshot()
+  {
+    if(m_snapshots_dirty)
+      update_snapshots();
+    return boost::atomic_load(&m_gray_snapshot);
+  }
+  //--------------------------------------------------------------------------------------------------
 }
 
 BOOST_CLASS_VERSION(nodetool::peerlist_manager, CURRENT_PEERLIST_STORAGE_ARCHIVE_VER)
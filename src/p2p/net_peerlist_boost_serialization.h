@@ -31,6 +31,11 @@
 
 #pragma once
 
+namespace nodetool
+{
+  struct peerlist_journal_entry;
+}
+
 namespace boost
 {
   namespace serialization
@@ -51,5 +56,12 @@ namespace boost
       a & pl.id;
       a & pl.last_seen;
     }    
+
+    template <class Archive, class ver_type>
+    inline void serialize(Archive &a,  nodetool::peerlist_journal_entry& e, const ver_type ver)
+    {
+      a & e.white;
+      a & e.entry;
+    }
   }
 }
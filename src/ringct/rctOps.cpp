@@ -28,6 +28,7 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include "misc_log_ex.h"
 #include "rctOps.h"
 using namespace crypto;
@@ -203,6 +204,127 @@ namespace rct {
         return aP;
     }
 
+    //Multi-exponentiation
+
+    namespace {
+        //bits pos to pos + c - 1 of a scalar
+        size_t scalarWindow(const key &s, size_t pos, size_t c) {
+            size_t w = 0;
+            for (size_t i = 0; i < c && pos + i < 256; ++i) {
+                w |= (size_t)((s.bytes[(pos + i) >> 3] >> ((pos + i) & 7)) & 1) << i;
+            }
+            return w;
+        }
+
+        void addP3(ge_p3 &A, const ge_p3 &B) {
+            ge_cached B2;
+            ge_p1p1 tmp;
+            ge_p3_to_cached(&B2, &B);
+            ge_add(&tmp, &A, &B2);
+            ge_p1p1_to_p3(&A, &tmp);
+        }
+
+        //every point gets its own precomputation, and they all share the doublings
+        key straus(const keyV &scalars, const std::vector<ge_p3> &points) {
+            const size_t n = points.size();
+            std::vector<geDsmp> pre(n);
+            std::vector<const unsigned char *> a(n);
+            std::vector<const ge_cached *> A(n);
+            std::vector<signed char> slides(256 * n);
+            for (size_t i = 0; i < n; ++i) {
+                ge_dsm_precomp(pre[i].k, &points[i]);
+                a[i] = scalars[i].bytes;
+                A[i] = pre[i].k;
+            }
+            ge_p2 R;
+            ge_multiscalarmult_precomp_vartime(&R, n, a.data(), A.data(), NULL, slides.data());
+            key rv;
+            ge_tobytes(rv.bytes, &R);
+            return rv;
+        }
+
+        //for each c-bit window of the scalars, the points are added in the bucket
+        //of their window value, and the buckets are then summed up by weight
+        key pippenger(const keyV &scalars, const std::vector<ge_p3> &points, size_t c) {
+            const size_t n = points.size();
+            std::vector<ge_cached> cached(n);
+            for (size_t i = 0; i < n; ++i) {
+                ge_p3_to_cached(&cached[i], &points[i]);
+            }
+            std::vector<ge_p3> buckets(((size_t)1 << c) - 1); //bucket b - 1 for window value b
+            std::vector<char> used(buckets.size());
+            ge_p3 R = ge_p3_identity, sum;
+            ge_p2 R2;
+            ge_p1p1 tmp;
+            for (size_t w = (256 + c - 1) / c; w-- > 0; ) {
+                ge_p3_to_p2(&R2, &R);
+                for (size_t i = 0; i < c; ++i) {
+                    ge_p2_dbl(&tmp, &R2);
+                    ge_p1p1_to_p2(&R2, &tmp);
+                }
+                ge_p1p1_to_p3(&R, &tmp);
+
+                std::fill(used.begin(), used.end(), 0);
+                for (size_t i = 0; i < n; ++i) {
+                    const size_t b = scalarWindow(scalars[i], w * c, c);
+                    if (b == 0)
+                        continue;
+                    if (used[b - 1]) {
+                        ge_add(&tmp, &buckets[b - 1], &cached[i]);
+                        ge_p1p1_to_p3(&buckets[b - 1], &tmp);
+                    } else {
+                        buckets[b - 1] = points[i];
+                        used[b - 1] = 1;
+                    }
+                }
+
+                //running sum from the top bucket down, so bucket b - 1 is added b times
+                bool have_sum = false;
+                for (size_t b = buckets.size(); b-- > 0; ) {
+                    if (used[b]) {
+                        if (have_sum) {
+                            addP3(sum, buckets[b]);
+                        } else {
+                            sum = buckets[b];
+                            have_sum = true;
+                        }
+                    }
+                    if (have_sum)
+                        addP3(R, sum);
+                }
+            }
+            key rv;
+            ge_p3_tobytes(rv.bytes, &R);
+            return rv;
+        }
+    }
+
+    //the sum of scalars[i] * points[i], for reduced scalars
+    key multiexp(const keyV &scalars, const std::vector<ge_p3> &points) {
+        CHECK_AND_ASSERT_THROW_MES(scalars.size() == points.size(), "Mismatched multiexp sizes");
+        const size_t n = points.size();
+        //both do about 256 doublings, so pick the one needing the fewest additions: Pippenger
+        //with c-bit windows needs one for each point and two for each bucket, in each window,
+        //and Straus' precomputation and additions come to about 80 of those for each point
+        size_t best_c = 0, best_cost = n * 80;
+        for (size_t c = 1; c <= 16; ++c) {
+            const size_t cost = (256 + c - 1) / c * (n + ((size_t)2 << c));
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_c = c;
+            }
+        }
+        return best_c ? pippenger(scalars, points, best_c) : straus(scalars, points);
+    }
+
+    key multiexp(const keyV &scalars, const keyV &points) {
+        std::vector<ge_p3> P(points.size());
+        for (size_t i = 0; i < points.size(); ++i) {
+            CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&P[i], points[i].bytes) == 0, "ge_frombytes_vartime failed at "+boost::lexical_cast<std::string>(__LINE__));
+        }
+        return multiexp(scalars, P);
+    }
+
     //Curve addition / subtractions
 
     //for curve points: AB = A + B
@@ -236,6 +358,13 @@ namespace rct {
         ge_tobytes(aGbB.bytes, &rv);
     }
 
+    //addKeys2 with B input after applying "precomp"
+    void addKeys2(key &aGbB, const key &a, const key &b, const ge_dsmp B) {
+        ge_p2 rv;
+        ge_double_scalarmult_base_precomp_vartime(&rv, b.bytes, B, a.bytes);
+        ge_tobytes(aGbB.bytes, &rv);
+    }
+
     //Does some precomputation to make addKeys3 more efficient
     // input B a curve point and output a ge_dsmp which has precomputation applied
     void precomp(ge_dsmp rv, const key & B) {
@@ -403,15 +532,19 @@ namespace rct {
     }
 
     void hashToPoint(key & pointk, const key & hh) {
+        ge_p3 res;
+        hashToPoint(res, hh);
+        ge_p3_tobytes(pointk.bytes, &res);
+    }    
+
+    void hashToPoint(ge_p3 & res, const key & hh) {
         ge_p2 point;
         ge_p1p1 point2;
-        ge_p3 res;
         key h = cn_fast_hash(hh); 
         ge_fromfe_frombytes_vartime(&point, h.bytes);
         ge_mul8(&point2, &point);
         ge_p1p1_to_p3(&res, &point2);        
-        ge_p3_tobytes(pointk.bytes, &res);
-    }    
+    }
 
     //sums a vector of curve points (for scalars use sc_add)
     void sumKeys(key & Csum, const keyV &  Cis) {
@@ -124,6 +124,11 @@ namespace rct {
     //Computes aH where H= toPoint(cn_fast_hash(G)), G the basepoint
     key scalarmultH(const key & a);
 
+    //Multi-exponentiation: the sum of scalars[i] * points[i], for reduced scalars
+    //uses Straus' interleaved windows for a few points and Pippenger's buckets for many
+    key multiexp(const keyV &scalars, const keyV &points);
+    key multiexp(const keyV &scalars, const std::vector<ge_p3> &points);
+
     //Curve addition / subtractions
 
     //for curve points: AB = A + B
@@ -132,6 +137,8 @@ namespace rct {
     void addKeys1(key &aGB, const key &a, const key & B);
     //aGbB = aG + bB where a, b are scalars, G is the basepoint and B is a point
     void addKeys2(key &aGbB, const key &a, const key &b, const key &B);
+    //B must be input after applying "precomp"
+    void addKeys2(key &aGbB, const key &a, const key &b, const ge_dsmp B);
     //Does some precomputation to make addKeys3 more efficient
     // input B a curve point and output a ge_dsmp which has precomputation applied
     void precomp(ge_dsmp rv, const key &B);
@@ -170,6 +177,7 @@ namespace rct {
     key hashToPointSimple(const key &in);
     key hashToPoint(const key &in);
     void hashToPoint(key &out, const key &in);
+    void hashToPoint(ge_p3 &out, const key &in);
 
     //sums a vector of curve points (for scalars use sc_add)
     void sumKeys(key & Csum, const key &Cis);
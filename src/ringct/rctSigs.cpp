@@ -34,6 +34,7 @@
 #include "common/thread_group.h"
 #include "common/util.h"
 #include "rctSigs.h"
+#include "crypto/point_cache.h"
 #include "cryptonote_core/cryptonote_format_utils.h"
 
 using namespace crypto;
@@ -76,18 +77,22 @@ namespace rct {
     
     //see above.
     bool verifyBorromean(const boroSig &bb, const ge_p3 P1[64], const ge_p3 P2[64]) {
-      key64 Lv1; key chash, LL;
+      key64 LL, Lv1; key chash;
       int ii = 0;
-      ge_p2 p2;
+      ge_p2 p2[64];
+      // the first terms only depend on ee, so they can all be computed before encoding
+      // them together, and so can the second terms once their challenges are known
       for (ii = 0; ii < 64; ii++) {
-        // equivalent of: addKeys2(LL, bb.s0[ii], bb.ee, P1[ii]);
-        ge_double_scalarmult_base_vartime(&p2, bb.ee.bytes, &P1[ii], bb.s0[ii].bytes);
-        ge_tobytes(LL.bytes, &p2);
-        chash = hash_to_scalar(LL);
+        // equivalent of: addKeys2(LL[ii], bb.s0[ii], bb.ee, P1[ii]);
+        ge_double_scalarmult_base_vartime(&p2[ii], bb.ee.bytes, &P1[ii], bb.s0[ii].bytes);
+      }
+      ge_tobytes_batch(LL[0].bytes, p2, 64);
+      for (ii = 0; ii < 64; ii++) {
+        chash = hash_to_scalar(LL[ii]);
         // equivalent of: addKeys2(Lv1[ii], bb.s1[ii], chash, P2[ii]);
-        ge_double_scalarmult_base_vartime(&p2, chash.bytes, &P2[ii], bb.s1[ii].bytes);
-        ge_tobytes(Lv1[ii].bytes, &p2);
+        ge_double_scalarmult_base_vartime(&p2[ii], chash.bytes, &P2[ii], bb.s1[ii].bytes);
       }
+      ge_tobytes_batch(Lv1[0].bytes, p2, 64);
       key eeComputed = hash_to_scalar(Lv1); //hash function fine
       return equalKeys(eeComputed, bb.ee);
     }
@@ -238,7 +243,7 @@ namespace rct {
         CHECK_AND_ASSERT_MES(sc_check(rv.cc.bytes) == 0, false, "Bad cc");
 
         size_t i = 0, j = 0, ii = 0;
-        key c,  L, R, Hi;
+        key c;
         key c_old = copy(rv.cc);
         vector<geDsmp> Ip(dsRows);
         for (i = 0 ; i < dsRows ; i++) {
@@ -247,21 +252,39 @@ namespace rct {
         size_t ndsRows = 3 * dsRows; //non Double Spendable Rows (see identity chains paper
         keyV toHash(1 + 3 * dsRows + 2 * (rows - dsRows));
         toHash[0] = message;
+        // the L and R of a column only depend on the previous challenge,
+        // so they are all computed before being encoded together
+        vector<ge_p2> LR(2 * dsRows + rows - dsRows);
+        keyV LRk(LR.size());
         i = 0;
         while (i < cols) {
             sc_0(c.bytes);
             for (j = 0; j < dsRows; j++) {
-                addKeys2(L, rv.ss[i][j], c_old, pk[i][j]);
+                // ring members are reused as decoys, so their precomputations are cached
+                ge_dsmp pk_pre;
+                ge_p3 Hi;
+                CHECK_AND_ASSERT_MES(dsm_precomp_cached(pk_pre, pk[i][j].bytes), false, "point conv failed");
+                // equivalent of: addKeys2(L, rv.ss[i][j], c_old, pk_pre);
+                ge_double_scalarmult_base_precomp_vartime(&LR[2 * j], c_old.bytes, pk_pre, rv.ss[i][j].bytes);
                 hashToPoint(Hi, pk[i][j]);
-                addKeys3(R, rv.ss[i][j], Hi, c_old, Ip[j].k);
+                // equivalent of: addKeys3(R, rv.ss[i][j], Hi, c_old, Ip[j].k);
+                ge_double_scalarmult_precomp_vartime(&LR[2 * j + 1], rv.ss[i][j].bytes, &Hi, c_old.bytes, Ip[j].k);
+            }
+            for (j = dsRows, ii = 0 ; j < rows ; j++, ii++) {
+                ge_p3 pk_p3;
+                CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&pk_p3, pk[i][j].bytes) == 0, false, "point conv failed");
+                // equivalent of: addKeys2(L, rv.ss[i][j], c_old, pk[i][j]);
+                ge_double_scalarmult_base_vartime(&LR[2 * dsRows + ii], c_old.bytes, &pk_p3, rv.ss[i][j].bytes);
+            }
+            ge_tobytes_batch(LRk[0].bytes, LR.data(), LR.size());
+            for (j = 0; j < dsRows; j++) {
                 toHash[3 * j + 1] = pk[i][j];
-                toHash[3 * j + 2] = L; 
-                toHash[3 * j + 3] = R;
+                toHash[3 * j + 2] = LRk[2 * j];
+                toHash[3 * j + 3] = LRk[2 * j + 1];
             }
             for (j = dsRows, ii = 0 ; j < rows ; j++, ii++) {
-                addKeys2(L, rv.ss[i][j], c_old, pk[i][j]);
                 toHash[ndsRows + 2 * ii + 1] = pk[i][j];
-                toHash[ndsRows + 2 * ii + 2] = L;
+                toHash[ndsRows + 2 * ii + 2] = LRk[2 * dsRows + ii];
             }
             c = hash_to_scalar(toHash);
             copy(c_old, c);
@@ -305,6 +328,24 @@ namespace rct {
         return sig;
     }
 
+    namespace {
+      // the H2 points never change, so they are only converted once
+      struct H2_cached_table {
+        ge_cached points[64];
+        H2_cached_table() {
+          for (size_t i = 0; i < 64; i++) {
+            ge_p3 p3;
+            CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&p3, H2[i].bytes) == 0, "point conv failed");
+            ge_p3_to_cached(&points[i], &p3);
+          }
+        }
+      };
+      const ge_cached *get_H2_cached() {
+        static const H2_cached_table table;
+        return table.points;
+      }
+    }
+
     //proveRange and verRange
     //proveRange gives C, and mask such that \sumCi = C
     //   c.f. http://eprint.iacr.org/2015/1098 section 5.1
@@ -319,17 +360,15 @@ namespace rct {
         ge_p3 CiH[64], asCi[64];
         int i = 0;
         ge_p3 Ctmp_p3 = ge_p3_identity;
+        const ge_cached *H2_cached = get_H2_cached();
         for (i = 0; i < 64; i++) {
           // faster equivalent of:
           // subKeys(CiH[i], as.Ci[i], H2[i]);
           // addKeys(Ctmp, Ctmp, as.Ci[i]);
           ge_cached cached;
-          ge_p3 p3;
           ge_p1p1 p1;
-          CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&p3, H2[i].bytes) == 0, false, "point conv failed");
-          ge_p3_to_cached(&cached, &p3);
           CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&asCi[i], as.Ci[i].bytes) == 0, false, "point conv failed");
-          ge_sub(&p1, &asCi[i], &cached);
+          ge_sub(&p1, &asCi[i], &H2_cached[i]);
           ge_p3_to_cached(&cached, &asCi[i]);
           ge_p1p1_to_p3(&CiH[i], &p1);
           ge_add(&p1, &Ctmp_p3, &cached);
@@ -354,13 +393,13 @@ namespace rct {
       hashes.push_back(rv.message);
       crypto::hash h;
 
-      std::stringstream ss;
-      binary_archive<true> ba(ss);
+      cryptonote::cn_fast_hash_sink sink;
+      binary_archive<true> ba(sink);
       const size_t inputs = rv.pseudoOuts.size();
       const size_t outputs = rv.ecdhInfo.size();
       CHECK_AND_ASSERT_THROW_MES(const_cast<rctSig&>(rv).serialize_rctsig_base(ba, inputs, outputs),
           "Failed to serialize rctSigBase");
-      cryptonote::get_blob_hash(ss.str(), h);
+      sink.finish(h);
       hashes.push_back(hash2rct(h));
 
       keyV kv;
@@ -483,24 +522,43 @@ namespace rct {
 
         keyV tmp(rows + 1);
         size_t i = 0, j = 0;
-        for (i = 0; i < rows + 1; i++) {
-            identity(tmp[i]);
-        }
         keyM M(cols, tmp);
 
-        //create the matrix to mg sig
-        for (j = 0; j < rows; j++) {
-            for (i = 0; i < cols; i++) {
-                M[i][j] = pubs[i][j].dest;
-                addKeys(M[i][rows], M[i][rows], pubs[i][j].mask); //add Ci in last row
-            }
+        // faster equivalent of:
+        // addKeys(M[i][rows], M[i][rows], pubs[i][j].mask) for each input Ci,
+        // subKeys(M[i][rows], M[i][rows], outPk[j].mask) for each output Ci,
+        // and subKeys(M[i][rows], M[i][rows], txnFeeKey)
+        ge_cached cached;
+        ge_p1p1 p1;
+        ge_p3 p3, out_p3 = ge_p3_identity;
+        for (j = 0; j < outPk.size(); j++) {
+            CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&p3, outPk[j].mask.bytes) == 0, false, "point conv failed");
+            ge_p3_to_cached(&cached, &p3);
+            ge_add(&p1, &out_p3, &cached);
+            ge_p1p1_to_p3(&out_p3, &p1);
         }
+        CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&p3, txnFeeKey.bytes) == 0, false, "point conv failed");
+        ge_p3_to_cached(&cached, &p3);
+        ge_add(&p1, &out_p3, &cached);
+        ge_p1p1_to_p3(&out_p3, &p1);
+        ge_cached out_cached;
+        ge_p3_to_cached(&out_cached, &out_p3);
+
+        //create the matrix to mg sig
         for (i = 0; i < cols; i++) {
-            for (j = 0; j < outPk.size(); j++) {
-                subKeys(M[i][rows], M[i][rows], outPk[j].mask); //subtract output Ci's in last row
+            ge_p3 sum_p3 = ge_p3_identity;
+            for (j = 0; j < rows; j++) {
+                M[i][j] = pubs[i][j].dest;
+                //add Ci in last row, ring members are reused as decoys so they are cached
+                CHECK_AND_ASSERT_MES(frombytes_cached(p3, pubs[i][j].mask.bytes), false, "point conv failed");
+                ge_p3_to_cached(&cached, &p3);
+                ge_add(&p1, &sum_p3, &cached);
+                ge_p1p1_to_p3(&sum_p3, &p1);
             }
-            //subtract txn fee output in last row
-            subKeys(M[i][rows], M[i][rows], txnFeeKey);
+            //subtract output Ci's and txn fee output in last row
+            ge_sub(&p1, &sum_p3, &out_cached);
+            ge_p1p1_to_p3(&sum_p3, &p1);
+            ge_p3_tobytes(M[i][rows].bytes, &sum_p3);
         }
         return MLSAG_Ver(message, M, mg, rows);
     }
@@ -520,10 +578,22 @@ namespace rct {
             keyV tmp(rows + 1);
             size_t i;
             keyM M(cols, tmp);
+            ge_p3 C_p3;
+            ge_cached C_cached;
+            CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&C_p3, C.bytes) == 0, false, "point conv failed");
+            ge_p3_to_cached(&C_cached, &C_p3);
             //create the matrix to mg sig
             for (i = 0; i < cols; i++) {
                     M[i][0] = pubs[i].dest;
-                    subKeys(M[i][1], pubs[i].mask, C);
+                    // faster equivalent of:
+                    // subKeys(M[i][1], pubs[i].mask, C);
+                    // ring members are reused as decoys, so their Ci are cached
+                    ge_p3 mask_p3;
+                    ge_p1p1 p1;
+                    CHECK_AND_ASSERT_MES(frombytes_cached(mask_p3, pubs[i].mask.bytes), false, "point conv failed");
+                    ge_sub(&p1, &mask_p3, &C_cached);
+                    ge_p1p1_to_p3(&mask_p3, &p1);
+                    ge_p3_tobytes(M[i][1].bytes, &mask_p3);
             }
             //DP(C);
             return MLSAG_Ver(message, M, mg, rows);
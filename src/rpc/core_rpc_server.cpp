@@ -39,6 +39,9 @@ using namespace epee;
 #include "cryptonote_core/cryptonote_basic_impl.h"
 #include "misc_language.h"
 #include "crypto/hash.h"
+#include "ringct/rctSigs.h"
+#include "common/threadpool.h"
+#include "blockchain_db/block_filter.h"
 #include "core_rpc_server_error_codes.h"
 
 #define MAX_RESTRICTED_FAKE_OUTS_COUNT 40
@@ -56,6 +59,8 @@ namespace cryptonote
     command_line::add_arg(desc, arg_restricted_rpc);
     command_line::add_arg(desc, arg_user_agent);
     command_line::add_arg(desc, arg_callback_point);
+    command_line::add_arg(desc, arg_rpc_enable_view_scan);
+    command_line::add_arg(desc, arg_rpc_io_shards);
   }
   //------------------------------------------------------------------------------------------------------------------------------
   core_rpc_server::core_rpc_server(
@@ -75,6 +80,12 @@ namespace cryptonote
     m_bind_ip = command_line::get_arg(vm, arg_rpc_bind_ip);
     m_port = command_line::get_arg(vm, p2p_bind_arg);
     m_restricted = command_line::get_arg(vm, arg_restricted_rpc);
+    m_view_scan = command_line::get_arg(vm, arg_rpc_enable_view_scan);
+    if (m_view_scan && !m_restricted)
+      LOG_PRINT_L0("View key scanning is enabled: clients of this RPC server can submit private view keys");
+    const uint32_t io_shards = command_line::get_arg(vm, arg_rpc_io_shards);
+    if (io_shards)
+      set_io_service_shards(io_shards);
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -153,14 +164,19 @@ namespace cryptonote
     CHECK_CORE_BUSY();
     std::list<std::pair<block, std::list<transaction> > > bs;
 
-    if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT))
+    // replies are capped in size as well as in count, clients carry on from start_height + blocks.size()
+    const size_t max_size = req.max_size == 0 || req.max_size > COMMAND_RPC_GET_BLOCKS_FAST_MAX_SIZE ? COMMAND_RPC_GET_BLOCKS_FAST_MAX_SIZE : req.max_size;
+    if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT, max_size))
     {
       res.status = "Failed";
       return false;
     }
 
-    BOOST_FOREACH(auto& b, bs)
+    // drop each parsed block as soon as it is converted, so we do not hold
+    // both the parsed and the serialized copy of the whole batch at once
+    while (!bs.empty())
     {
+      const auto& b = bs.front();
       res.blocks.resize(res.blocks.size()+1);
       res.blocks.back().block = block_to_blob(b.first);
       res.output_indices.push_back(COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices());
@@ -174,7 +190,7 @@ namespace cryptonote
       size_t txidx = 0;
       BOOST_FOREACH(auto& t, b.second)
       {
-        res.blocks.back().txs.push_back(tx_to_blob(t));
+        res.blocks.back().txs.push_back(req.prune ? pruned_tx_to_blob(t) : tx_to_blob(t));
         res.output_indices.back().indices.push_back(COMMAND_RPC_GET_BLOCKS_FAST::tx_output_indices());
         bool r = m_core.get_tx_outputs_gindexs(b.first.tx_hashes[txidx++], res.output_indices.back().indices.back().indices);
         if (!r)
@@ -183,6 +199,7 @@ namespace cryptonote
           return false;
         }
       }
+      bs.pop_front();
     }
 
     res.status = CORE_RPC_STATUS_OK;
@@ -208,6 +225,235 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  namespace
+  {
+    typedef COMMAND_RPC_SCAN_OUTPUTS::output_entry scan_output_entry;
+
+    // Checks every output of a transaction against the given view key and subaddress
+    // spend keys, decoding the amount of the ones that match. Only uses the arguments,
+    // so it can run concurrently on the thread pool.
+    void scan_tx_outputs(const transaction& tx, const crypto::hash& txid, bool coinbase, uint64_t height,
+      const crypto::secret_key& view_secret_key, const std::unordered_map<crypto::public_key, subaddress_index>& subaddresses,
+      std::vector<scan_output_entry>& outputs)
+    {
+      const crypto::public_key tx_pub_key = get_tx_pub_key_from_extra(tx);
+      if (tx_pub_key == null_pkey)
+        return;
+      crypto::key_derivation derivation;
+      if (!crypto::generate_key_derivation(tx_pub_key, view_secret_key, derivation))
+        return;
+      const std::vector<crypto::public_key> additional_tx_pub_keys = get_additional_tx_pub_keys_from_extra(tx);
+      std::vector<crypto::key_derivation> additional_derivations(additional_tx_pub_keys.size());
+      for (size_t i = 0; i < additional_tx_pub_keys.size(); ++i)
+      {
+        if (!crypto::generate_key_derivation(additional_tx_pub_keys[i], view_secret_key, additional_derivations[i]))
+          return;
+      }
+
+      for (size_t i = 0; i < tx.vout.size(); ++i)
+      {
+        if (tx.vout[i].target.type() != typeid(txout_to_key))
+          continue;
+        const crypto::public_key &out_key = boost::get<txout_to_key>(tx.vout[i].target).key;
+        boost::optional<subaddress_receive_info> received = is_out_to_acc_precomp(subaddresses, out_key, derivation, additional_derivations, i);
+        if (!received)
+          continue;
+
+        scan_output_entry e = AUTO_VAL_INIT(e);
+        e.height = height;
+        e.tx_hash = txid;
+        e.tx_pub_key = tx_pub_key;
+        e.internal_output_index = i;
+        e.key = out_key;
+        e.major = received->index.major;
+        e.minor = received->index.minor;
+        e.unlock_time = tx.unlock_time;
+        e.coinbase = coinbase;
+        if (tx.version == 1 || tx.rct_signatures.type == rct::RCTTypeNull)
+        {
+          e.amount = tx.vout[i].amount;
+          e.mask = rct::identity();
+        }
+        else
+        {
+          crypto::secret_key scalar;
+          crypto::derivation_to_scalar(received->derivation, i, scalar);
+          try
+          {
+            if (tx.rct_signatures.type == rct::RCTTypeSimple)
+              e.amount = rct::decodeRctSimple(tx.rct_signatures, rct::sk2rct(scalar), i, e.mask);
+            else if (tx.rct_signatures.type == rct::RCTTypeFull)
+              e.amount = rct::decodeRct(tx.rct_signatures, rct::sk2rct(scalar), i, e.mask);
+            else
+              continue;
+          }
+          catch (const std::exception &ex)
+          {
+            LOG_PRINT_L1("Failed to decode output " << i << " of tx " << txid);
+            continue;
+          }
+        }
+        outputs.push_back(e);
+      }
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_scan_outputs(const COMMAND_RPC_SCAN_OUTPUTS::request& req, COMMAND_RPC_SCAN_OUTPUTS::response& res)
+  {
+    CHECK_CORE_BUSY();
+
+    if (req.count == 0 || req.count > COMMAND_RPC_SCAN_OUTPUTS_MAX_COUNT)
+    {
+      res.status = "Invalid block count";
+      return true;
+    }
+    if (req.accounts == 0 || req.subaddresses == 0 || (uint64_t)req.accounts * req.subaddresses > COMMAND_RPC_SCAN_OUTPUTS_MAX_SUBADDRESSES)
+    {
+      res.status = "Invalid subaddress lookahead";
+      return true;
+    }
+    if (sc_check((const unsigned char*)&req.view_secret_key) != 0)
+    {
+      res.status = "Invalid view secret key";
+      return true;
+    }
+
+    account_keys keys = AUTO_VAL_INIT(keys);
+    keys.m_account_address.m_spend_public_key = req.spend_public_key;
+    keys.m_view_secret_key = req.view_secret_key;
+    std::unordered_map<crypto::public_key, subaddress_index> subaddresses;
+    try
+    {
+      for (uint32_t major = 0; major < req.accounts; ++major)
+      {
+        const std::vector<crypto::public_key> pkeys = get_subaddress_spend_public_keys(keys, major, 0, req.subaddresses);
+        for (uint32_t minor = 0; minor < pkeys.size(); ++minor)
+          subaddresses[pkeys[minor]] = {major, minor};
+      }
+    }
+    catch (const std::exception &e)
+    {
+      res.status = "Invalid spend public key";
+      return true;
+    }
+
+    res.current_height = m_core.get_current_blockchain_height();
+    res.start_height = req.start_height;
+    res.end_height = req.start_height;
+    if (req.start_height >= res.current_height)
+    {
+      res.status = CORE_RPC_STATUS_OK;
+      return true;
+    }
+
+    // database reads are serialized by the blockchain lock anyway, so load everything
+    // up front and only spread the key derivations over the thread pool
+    std::list<block> blocks_list;
+    if (!m_core.get_blocks(req.start_height, req.count, blocks_list))
+    {
+      res.status = "Failed";
+      return false;
+    }
+    const std::vector<block> blocks(blocks_list.begin(), blocks_list.end());
+    std::vector<std::list<transaction>> txs(blocks.size());
+    for (size_t b = 0; b < blocks.size(); ++b)
+    {
+      std::list<crypto::hash> missed_txs;
+      if (!m_core.get_transactions(blocks[b].tx_hashes, txs[b], missed_txs) || !missed_txs.empty())
+      {
+        res.status = "Failed";
+        return false;
+      }
+    }
+
+    std::vector<std::vector<scan_output_entry>> found(blocks.size());
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    tools::threadpool::waiter waiter;
+    for (size_t b = 0; b < blocks.size(); ++b)
+    {
+      tpool.submit(&waiter, [&, b]() {
+        const uint64_t height = req.start_height + b;
+        scan_tx_outputs(blocks[b].miner_tx, get_transaction_hash(blocks[b].miner_tx), true, height, req.view_secret_key, subaddresses, found[b]);
+        size_t txidx = 0;
+        for (const transaction &tx: txs[b])
+          scan_tx_outputs(tx, blocks[b].tx_hashes[txidx++], false, height, req.view_secret_key, subaddresses, found[b]);
+      });
+    }
+    waiter.wait();
+
+    // global indices are only looked up for the (few) matching transactions
+    std::unordered_map<crypto::hash, std::vector<uint64_t>> gindexes;
+    for (std::vector<scan_output_entry> &block_outputs: found)
+    {
+      for (scan_output_entry &e: block_outputs)
+      {
+        auto it = gindexes.find(e.tx_hash);
+        if (it == gindexes.end())
+        {
+          it = gindexes.insert(std::make_pair(e.tx_hash, std::vector<uint64_t>())).first;
+          if (!m_core.get_tx_outputs_gindexs(e.tx_hash, it->second))
+          {
+            res.status = "Failed";
+            return false;
+          }
+        }
+        CHECK_AND_ASSERT_MES(e.internal_output_index < it->second.size(), false, "Output index out of range for tx " << e.tx_hash);
+        e.global_output_index = it->second[e.internal_output_index];
+        res.outputs.push_back(e);
+      }
+    }
+
+    res.end_height = req.start_height + blocks.size();
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_block_filters(const COMMAND_RPC_GET_BLOCK_FILTERS::request& req, COMMAND_RPC_GET_BLOCK_FILTERS::response& res)
+  {
+    CHECK_CORE_BUSY();
+
+    if (req.count == 0 || req.count > COMMAND_RPC_GET_BLOCK_FILTERS_MAX_COUNT)
+    {
+      res.status = "Invalid block count";
+      return true;
+    }
+
+    BlockchainDB &db = m_core.get_blockchain_storage().get_db();
+    res.current_height = m_core.get_current_blockchain_height();
+    res.start_height = req.start_height;
+    const uint64_t end_height = std::min(res.current_height, req.start_height + req.count);
+    for (uint64_t height = req.start_height; height < end_height; ++height)
+    {
+      COMMAND_RPC_GET_BLOCK_FILTERS::filter_entry e;
+      try
+      {
+        e.block_hash = db.get_block_hash_from_height(height);
+        if (!db.get_block_filter(height, e.filter))
+        {
+          // stored before block filters existed, build it on the fly
+          const block b = db.get_block_from_height(height);
+          std::vector<transaction> txs;
+          txs.reserve(b.tx_hashes.size());
+          for (const crypto::hash &tx_hash: b.tx_hashes)
+            txs.push_back(db.get_tx(tx_hash));
+          std::vector<block_filter_element> elements;
+          get_block_filter_elements(b, txs, elements);
+          e.filter = make_block_filter(e.block_hash, elements);
+        }
+      }
+      catch (const std::exception &ex)
+      {
+        LOG_ERROR("Failed to get block filter at height " << height << ": " << ex.what());
+        res.status = "Failed";
+        return false;
+      }
+      res.filters.push_back(e);
+    }
+
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res)
   {
     CHECK_CORE_BUSY();
@@ -478,33 +724,44 @@ namespace cryptonote
       res.spent_status.push_back(spent_status[n] ? COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_BLOCKCHAIN : COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT);
 
     // check the pool too
-    std::vector<cryptonote::tx_info> txs;
-    std::vector<cryptonote::spent_key_image_info> ki;
-    r = m_core.get_pool_transactions_and_spent_keys_info(txs, ki);
+    r = m_core.are_key_images_spent_in_pool(key_images, spent_status);
     if(!r)
     {
       res.status = "Failed";
       return true;
     }
-    for (std::vector<cryptonote::spent_key_image_info>::const_iterator i = ki.begin(); i != ki.end(); ++i)
+    for (size_t n = 0; n < res.spent_status.size(); ++n)
     {
-      crypto::hash hash;
-      crypto::key_image spent_key_image;
-      if (parse_hash256(i->id_hash, hash))
-      {
-        memcpy(&spent_key_image, &hash, sizeof(hash)); // a bit dodgy, should be other parse functions somewhere
-        for (size_t n = 0; n < res.spent_status.size(); ++n)
-        {
-          if (res.spent_status[n] == COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT)
-          {
-            if (key_images[n] == spent_key_image)
-            {
-              res.spent_status[n] = COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_POOL;
-              break;
-            }
-          }
-        }
-      }
+      if (res.spent_status[n] == COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT && spent_status[n])
+        res.spent_status[n] = COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_POOL;
+    }
+
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_are_key_images_spent(const COMMAND_RPC_ARE_KEY_IMAGES_SPENT::request& req, COMMAND_RPC_ARE_KEY_IMAGES_SPENT::response& res)
+  {
+    CHECK_CORE_BUSY();
+    if (req.key_images.size() > COMMAND_RPC_ARE_KEY_IMAGES_SPENT_MAX_COUNT)
+    {
+      res.status = "Failed, too many key images";
+      return true;
+    }
+
+    std::vector<bool> spent_in_chain, spent_in_pool;
+    if (!m_core.are_key_images_spent(req.key_images, spent_in_chain) || !m_core.are_key_images_spent_in_pool(req.key_images, spent_in_pool))
+    {
+      res.status = "Failed";
+      return true;
+    }
+
+    res.spent_status.assign((req.key_images.size() + 3) / 4, 0);
+    for (size_t n = 0; n < req.key_images.size(); ++n)
+    {
+      const int status = spent_in_chain[n] ? COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_BLOCKCHAIN :
+          spent_in_pool[n] ? COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_POOL : COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT;
+      res.spent_status[n / 4] |= status << ((n % 4) * 2);
     }
 
     res.status = CORE_RPC_STATUS_OK;
@@ -525,7 +782,8 @@ namespace cryptonote
 
     cryptonote_connection_context fake_context = AUTO_VAL_INIT(fake_context);
     tx_verification_context tvc = AUTO_VAL_INIT(tvc);
-    if(!m_core.handle_incoming_tx(tx_blob, tvc, false, false) || tvc.m_verifivation_failed)
+    crypto::hash tx_hash;
+    if(!m_core.handle_incoming_tx(tx_blob, tvc, false, false, tx_hash) || tvc.m_verifivation_failed)
     {
       if (tvc.m_verifivation_failed)
       {
@@ -571,6 +829,7 @@ namespace cryptonote
     NOTIFY_NEW_TRANSACTIONS::request r;
     r.txs.push_back(tx_blob);
     m_core.get_protocol()->relay_transactions(r, fake_context);
+    m_core.on_transactions_relayed(std::list<crypto::hash>(1, tx_hash));
     //TODO: make sure that tx has reached other nodes here, probably wait to receive reflections from other nodes
     res.status = CORE_RPC_STATUS_OK;
     return true;
@@ -1429,4 +1688,16 @@ namespace cryptonote
     , ""
     };
 
+  const command_line::arg_descriptor<bool> core_rpc_server::arg_rpc_enable_view_scan = {
+      "rpc-enable-view-scan"
+    , "Allow clients to scan blocks for their outputs with a private view key (never available with --restricted-rpc)"
+    , false
+    };
+
+  const command_line::arg_descriptor<uint32_t> core_rpc_server::arg_rpc_io_shards = {
+      "rpc-io-shards"
+    , "Spread RPC connections over this many network threads, each with its own event loop (0 to share one loop)"
+    , 0
+    };
+
 }  // namespace cryptonote
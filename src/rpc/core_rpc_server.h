@@ -59,6 +59,8 @@ namespace cryptonote
     static const command_line::arg_descriptor<std::string> arg_callback_point;
     static const command_line::arg_descriptor<bool> arg_restricted_rpc;
     static const command_line::arg_descriptor<std::string> arg_user_agent;
+    static const command_line::arg_descriptor<bool> arg_rpc_enable_view_scan;
+    static const command_line::arg_descriptor<uint32_t> arg_rpc_io_shards;
 
     typedef epee::net_utils::connection_context_base connection_context;
 
@@ -79,12 +81,15 @@ namespace cryptonote
       MAP_URI_AUTO_JON2("/getheight", on_get_height, COMMAND_RPC_GET_HEIGHT)
       MAP_URI_AUTO_BIN2("/getblocks.bin", on_get_blocks, COMMAND_RPC_GET_BLOCKS_FAST)
       MAP_URI_AUTO_BIN2("/gethashes.bin", on_get_hashes, COMMAND_RPC_GET_HASHES_FAST)
+      MAP_URI_AUTO_BIN2_IF("/scan_outputs.bin", on_scan_outputs, COMMAND_RPC_SCAN_OUTPUTS, !m_restricted && m_view_scan)
+      MAP_URI_AUTO_BIN2("/get_block_filters.bin", on_get_block_filters, COMMAND_RPC_GET_BLOCK_FILTERS)
       MAP_URI_AUTO_BIN2("/get_o_indexes.bin", on_get_indexes, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES)      
       MAP_URI_AUTO_BIN2("/getrandom_outs.bin", on_get_random_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS)      
       MAP_URI_AUTO_BIN2("/get_outs.bin", on_get_outs_bin, COMMAND_RPC_GET_OUTPUTS_BIN)
       MAP_URI_AUTO_BIN2("/getrandom_rctouts.bin", on_get_random_rct_outs, COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS)
       MAP_URI_AUTO_JON2("/gettransactions", on_get_transactions, COMMAND_RPC_GET_TRANSACTIONS)
       MAP_URI_AUTO_JON2("/is_key_image_spent", on_is_key_image_spent, COMMAND_RPC_IS_KEY_IMAGE_SPENT)
+      MAP_URI_AUTO_BIN2("/are_key_images_spent.bin", on_are_key_images_spent, COMMAND_RPC_ARE_KEY_IMAGES_SPENT)
       MAP_URI_AUTO_JON2("/sendrawtransaction", on_send_raw_tx, COMMAND_RPC_SEND_RAW_TX)
       MAP_URI_AUTO_JON2_IF("/start_mining", on_start_mining, COMMAND_RPC_START_MINING, !m_restricted)
       MAP_URI_AUTO_JON2_IF("/stop_mining", on_stop_mining, COMMAND_RPC_STOP_MINING, !m_restricted)
@@ -126,8 +131,11 @@ namespace cryptonote
     bool on_get_height(const COMMAND_RPC_GET_HEIGHT::request& req, COMMAND_RPC_GET_HEIGHT::response& res);
     bool on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res);
     bool on_get_hashes(const COMMAND_RPC_GET_HASHES_FAST::request& req, COMMAND_RPC_GET_HASHES_FAST::response& res);
+    bool on_scan_outputs(const COMMAND_RPC_SCAN_OUTPUTS::request& req, COMMAND_RPC_SCAN_OUTPUTS::response& res);
+    bool on_get_block_filters(const COMMAND_RPC_GET_BLOCK_FILTERS::request& req, COMMAND_RPC_GET_BLOCK_FILTERS::response& res);
     bool on_get_transactions(const COMMAND_RPC_GET_TRANSACTIONS::request& req, COMMAND_RPC_GET_TRANSACTIONS::response& res);
     bool on_is_key_image_spent(const COMMAND_RPC_IS_KEY_IMAGE_SPENT::request& req, COMMAND_RPC_IS_KEY_IMAGE_SPENT::response& res);
+    bool on_are_key_images_spent(const COMMAND_RPC_ARE_KEY_IMAGES_SPENT::request& req, COMMAND_RPC_ARE_KEY_IMAGES_SPENT::response& res);
     bool on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res);
     bool on_send_raw_tx(const COMMAND_RPC_SEND_RAW_TX::request& req, COMMAND_RPC_SEND_RAW_TX::response& res);
     bool on_start_mining(const COMMAND_RPC_START_MINING::request& req, COMMAND_RPC_START_MINING::response& res);
@@ -188,5 +196,6 @@ private:
     std::string m_bind_ip;
     bool m_testnet;
     bool m_restricted;
+    bool m_view_scan;
   };
 }
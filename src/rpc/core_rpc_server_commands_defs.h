@@ -49,7 +49,7 @@ namespace cryptonote
 // advance which version they will stop working with
 // Don't go over 32767 for any of these
 #define CORE_RPC_VERSION_MAJOR 1
-#define CORE_RPC_VERSION_MINOR 0
+#define CORE_RPC_VERSION_MINOR 5
 #define CORE_RPC_VERSION (((CORE_RPC_VERSION_MAJOR)<<16)|(CORE_RPC_VERSION_MINOR))
 
   struct COMMAND_RPC_GET_HEIGHT
@@ -79,9 +79,13 @@ namespace cryptonote
     {
       std::list<crypto::hash> block_ids; //*first 10 blocks id goes sequential, next goes in pow(2,n) offset, like 2, 4, 8, 16, 32, 64 and so on, and the last one is always genesis block */
       uint64_t    start_height;
+      uint64_t    max_size; // bytes, 0 or anything above COMMAND_RPC_GET_BLOCKS_FAST_MAX_SIZE means the max
+      bool        prune; // send txes without their prunable data, see transaction::serialize_base
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_CONTAINER_POD_AS_BLOB(block_ids)
         KV_SERIALIZE(start_height)
+        KV_SERIALIZE(max_size)
+        KV_SERIALIZE(prune)
       END_KV_SERIALIZE_MAP()
     };
 
@@ -150,6 +154,118 @@ namespace cryptonote
     };
   };
 
+  //-----------------------------------------------
+  struct COMMAND_RPC_SCAN_OUTPUTS
+  {
+    struct request
+    {
+      crypto::secret_key view_secret_key;
+      crypto::public_key spend_public_key;
+      uint32_t accounts;     // subaddress lookahead: major indices [0, accounts)
+      uint32_t subaddresses; // subaddress lookahead: minor indices [0, subaddresses)
+      uint64_t start_height;
+      uint64_t count;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_VAL_POD_AS_BLOB(view_secret_key)
+        KV_SERIALIZE_VAL_POD_AS_BLOB(spend_public_key)
+        KV_SERIALIZE(accounts)
+        KV_SERIALIZE(subaddresses)
+        KV_SERIALIZE(start_height)
+        KV_SERIALIZE(count)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct output_entry
+    {
+      uint64_t height;
+      crypto::hash tx_hash;
+      crypto::public_key tx_pub_key;
+      uint64_t internal_output_index;
+      uint64_t global_output_index;
+      crypto::public_key key;
+      uint64_t amount;
+      rct::key mask;
+      uint32_t major;
+      uint32_t minor;
+      uint64_t unlock_time;
+      bool coinbase;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(height)
+        KV_SERIALIZE_VAL_POD_AS_BLOB(tx_hash)
+        KV_SERIALIZE_VAL_POD_AS_BLOB(tx_pub_key)
+        KV_SERIALIZE(internal_output_index)
+        KV_SERIALIZE(global_output_index)
+        KV_SERIALIZE_VAL_POD_AS_BLOB(key)
+        KV_SERIALIZE(amount)
+        KV_SERIALIZE_VAL_POD_AS_BLOB(mask)
+        KV_SERIALIZE(major)
+        KV_SERIALIZE(minor)
+        KV_SERIALIZE(unlock_time)
+        KV_SERIALIZE(coinbase)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      std::vector<output_entry> outputs;
+      uint64_t start_height;
+      uint64_t end_height; // one past the last scanned block, to be used as the next start_height
+      uint64_t current_height;
+      std::string status;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(outputs)
+        KV_SERIALIZE(start_height)
+        KV_SERIALIZE(end_height)
+        KV_SERIALIZE(current_height)
+        KV_SERIALIZE(status)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
+  //-----------------------------------------------
+  struct COMMAND_RPC_GET_BLOCK_FILTERS
+  {
+    struct request
+    {
+      uint64_t start_height;
+      uint64_t count;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(start_height)
+        KV_SERIALIZE(count)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct filter_entry
+    {
+      crypto::hash block_hash;
+      std::string filter; // see block_filter.h for the format
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_VAL_POD_AS_BLOB(block_hash)
+        KV_SERIALIZE(filter)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      std::vector<filter_entry> filters;
+      uint64_t start_height;
+      uint64_t current_height;
+      std::string status;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(filters)
+        KV_SERIALIZE(start_height)
+        KV_SERIALIZE(current_height)
+        KV_SERIALIZE(status)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
   //-----------------------------------------------
   struct COMMAND_RPC_GET_TRANSACTIONS
   {
@@ -237,6 +353,36 @@ namespace cryptonote
     };
   };
 
+  //-----------------------------------------------
+  struct COMMAND_RPC_ARE_KEY_IMAGES_SPENT
+  {
+    struct request
+    {
+      std::vector<crypto::key_image> key_images;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(key_images)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      // 2 bits per key image, low bits first: a COMMAND_RPC_IS_KEY_IMAGE_SPENT::STATUS
+      std::string spent_status;
+      std::string status;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(spent_status)
+        KV_SERIALIZE(status)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    static int get_status(const std::string& spent_status, size_t n)
+    {
+      return (spent_status[n / 4] >> ((n % 4) * 2)) & 3;
+    }
+  };
+
   //-----------------------------------------------
   struct COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES
   {
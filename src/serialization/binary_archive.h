@@ -35,11 +35,14 @@
 #pragma once
 
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <iterator>
+#include <string>
 #include <boost/type_traits/make_unsigned.hpp>
 
 #include "common/varint.h"
+#include "span.h"
 #include "warnings.h"
 
 /* I have no clue what these lines means */
@@ -48,62 +51,78 @@ DISABLE_VS_WARNINGS(4244)
 
 //TODO: fix size_t warning in x32 platform
 
-/*! \struct binary_archive_base
- *
- * \brief base for the binary archive type
- * 
- * \detailed It isn't used outside of this file, which its only
- * purpse is to define the functions used for the binary_archive. Its
- * a header, basically. I think it was declared simply to save typing...
- */
-template <class Stream, bool IsSaving>
-struct binary_archive_base
-{
-  typedef Stream stream_type;
-  typedef binary_archive_base<Stream, IsSaving> base_type;
-  typedef boost::mpl::bool_<IsSaving> is_saving;
-
-  typedef uint8_t variant_tag_type;
-
-  explicit binary_archive_base(stream_type &s) : stream_(s) { }
-  
-  /* definition of standard API functions */
-  void tag(const char *) { }
-  void begin_object() { }
-  void end_object() { }
-  void begin_variant() { }
-  void end_variant() { }
-  /* I just want to leave a comment saying how this line really shows
-     flaws in the ownership model of many OOP languages, that is all. */
-  stream_type &stream() { return stream_; } 
-
-protected:
-  stream_type &stream_;
-};
-
 /* \struct binary_archive
  *
  * \brief the actualy binary archive type
  *
  * \detailed The boolean template argument /a W is the is_saving
- * parameter for binary_archive_base.
- *
- * The is_saving parameter says whether the archive is being read from
- * (false) or written to (true)
+ * parameter: whether the archive is being read from (false) or
+ * written to (true)
  */
 template <bool W>
 struct binary_archive;
 
 
+/* \struct binary_archive_sink
+ *
+ * \brief takes the bytes of a saving binary_archive as they are written
+ *
+ * \detailed For consumers which do not need the whole blob at once,
+ * such as a hash, so it never has to be put together in memory.
+ */
+struct binary_archive_sink
+{
+  virtual ~binary_archive_sink() { }
+  virtual void write(const void *data, size_t len) = 0;
+};
+
+/* \struct binary_archive<false>
+ *
+ * \brief reads straight from a span of bytes
+ *
+ * \detailed There is no stream underneath: the archive keeps the bytes
+ * left to read and its own error state, and is its own stream(), with
+ * the few std::istream members the serializers use (good, rdstate,
+ * setstate, clear and peek). The bytes must outlive the archive.
+ */
 template <>
-struct binary_archive<false> : public binary_archive_base<std::istream, false>
+struct binary_archive<false>
 {
+  typedef binary_archive<false> stream_type;
+  typedef boost::mpl::bool_<false> is_saving;
+
+  typedef uint8_t variant_tag_type;
+
+  explicit binary_archive(epee::span<const std::uint8_t> bytes) : bytes_(bytes), state_(std::ios_base::goodbit) { }
+
+  /* definition of standard API functions */
+  void tag(const char *) { }
+  void begin_object() { }
+  void end_object() { }
+  void begin_variant() { }
+  void end_variant() { }
+  stream_type &stream() { return *this; }
 
-  explicit binary_archive(stream_type &s) : base_type(s) {
-    stream_type::streampos pos = stream_.tellg();
-    stream_.seekg(0, std::ios_base::end);
-    eof_pos_ = stream_.tellg();
-    stream_.seekg(pos);
+  /* the std::istream subset */
+  bool good() const { return state_ == std::ios_base::goodbit; }
+  bool fail() const { return (state_ & (std::ios_base::failbit | std::ios_base::badbit)) != 0; }
+  bool eof() const { return (state_ & std::ios_base::eofbit) != 0; }
+  std::ios_base::iostate rdstate() const { return state_; }
+  void setstate(std::ios_base::iostate state) { state_ |= state; }
+  void clear(std::ios_base::iostate state = std::ios_base::goodbit) { state_ = state; }
+  int peek()
+  {
+    if (!good())
+    {
+      state_ |= std::ios_base::failbit;
+      return EOF;
+    }
+    if (bytes_.empty())
+    {
+      state_ |= std::ios_base::eofbit;
+      return EOF;
+    }
+    return bytes_[0];
   }
 
   template <class T>
@@ -119,22 +138,33 @@ struct binary_archive<false> : public binary_archive_base<std::istream, false>
   template <class T>
   void serialize_uint(T &v, size_t width = sizeof(T))
   {
+    if (!good() || bytes_.size() < width)
+    {
+      state_ |= std::ios_base::eofbit | std::ios_base::failbit;
+      v = 0;
+      return;
+    }
     T ret = 0;
     unsigned shift = 0;
     for (size_t i = 0; i < width; i++) {
-      //std::cerr << "tell: " << stream_.tellg() << " value: " << ret << std::endl;
-      char c;
-      stream_.get(c);
-      T b = (unsigned char)c;
-      ret += (b << shift);	// can this be changed to OR, i think it can.
+      T b = bytes_[i];
+      ret |= (b << shift);
       shift += 8;
     }
+    bytes_.remove_prefix(width);
     v = ret;
   }
   
   void serialize_blob(void *buf, size_t len, const char *delimiter="")
   {
-    stream_.read((char *)buf, len);
+    if (!good() || bytes_.size() < len)
+    {
+      state_ |= std::ios_base::eofbit | std::ios_base::failbit;
+      return;
+    }
+    if (len)
+      memcpy(buf, bytes_.data(), len);
+    bytes_.remove_prefix(len);
   }
   
   template <class T>
@@ -146,8 +176,16 @@ struct binary_archive<false> : public binary_archive_base<std::istream, false>
   template <class T>
   void serialize_uvarint(T &v)
   {
-    typedef std::istreambuf_iterator<char> it;
-    tools::read_varint(it(stream_), it(), v); // XXX handle failure
+    if (!good())
+      return;
+    const int read = tools::read_varint(bytes_.begin(), bytes_.end(), v);
+    if (read <= 0 || (bytes_[read - 1] & 0x80))
+    {
+      // overflowing, not in its shortest form, or cut short
+      state_ |= std::ios_base::eofbit | std::ios_base::failbit;
+      return;
+    }
+    bytes_.remove_prefix(read);
   }
 
   void begin_array(size_t &s)
@@ -167,20 +205,57 @@ struct binary_archive<false> : public binary_archive_base<std::istream, false>
   }
 
   size_t remaining_bytes() {
-    if (!stream_.good())
+    if (!good())
       return 0;
-    //std::cerr << "tell: " << stream_.tellg() << std::endl;
-    assert(stream_.tellg() <= eof_pos_);
-    return eof_pos_ - stream_.tellg();
+    return bytes_.size();
   }
 protected:
-  std::streamoff eof_pos_;
+  epee::span<const std::uint8_t> bytes_;
+  std::ios_base::iostate state_;
 };
 
+/* \struct binary_archive<true>
+ *
+ * \brief writes to a string, a stream or a sink, or just counts
+ *
+ * \detailed Appending to a std::string lets the caller reuse its
+ * buffer, and a default constructed archive only counts the bytes, to
+ * get the size of an object without writing it anywhere. Like the
+ * reading archive, it is its own stream() and keeps its own state.
+ */
 template <>
-struct binary_archive<true> : public binary_archive_base<std::ostream, true>
+struct binary_archive<true>
 {
-  explicit binary_archive(stream_type &s) : base_type(s) { }
+  typedef binary_archive<true> stream_type;
+  typedef boost::mpl::bool_<true> is_saving;
+
+  typedef uint8_t variant_tag_type;
+
+  binary_archive() : ostream_(NULL), string_(NULL), sink_(NULL), size_(0), state_(std::ios_base::goodbit) { }
+  explicit binary_archive(std::ostream &s) : ostream_(&s), string_(NULL), sink_(NULL), size_(0), state_(std::ios_base::goodbit) { }
+  explicit binary_archive(std::string &s) : ostream_(NULL), string_(&s), sink_(NULL), size_(0), state_(std::ios_base::goodbit) { }
+  explicit binary_archive(binary_archive_sink &s) : ostream_(NULL), string_(NULL), sink_(&s), size_(0), state_(std::ios_base::goodbit) { }
+
+  /* definition of standard API functions */
+  void tag(const char *) { }
+  void begin_object() { }
+  void end_object() { }
+  void begin_variant() { }
+  void end_variant() { }
+  stream_type &stream() { return *this; }
+
+  /* the std::ostream subset */
+  bool good() const { return state_ == std::ios_base::goodbit; }
+  bool fail() const { return (state_ & (std::ios_base::failbit | std::ios_base::badbit)) != 0; }
+  std::ios_base::iostate rdstate() const { return state_; }
+  void setstate(std::ios_base::iostate state) { state_ |= state; }
+  void clear(std::ios_base::iostate state = std::ios_base::goodbit) { state_ = state; }
+
+  /*! \fn size
+   *
+   * \brief the number of bytes written so far
+   */
+  size_t size() const { return size_; }
 
   template <class T>
   void serialize_int(T v)
@@ -190,15 +265,17 @@ struct binary_archive<true> : public binary_archive_base<std::ostream, true>
   template <class T>
   void serialize_uint(T v)
   {
+    uint8_t buf[sizeof(T)];
     for (size_t i = 0; i < sizeof(T); i++) {
-      stream_.put((char)(v & 0xff));
+      buf[i] = (uint8_t)(v & 0xff);
       if (1 < sizeof(T)) v >>= 8;
     }
+    write(buf, sizeof(T));
   }
 
   void serialize_blob(void *buf, size_t len, const char *delimiter="")
   {
-    stream_.write((char *)buf, len);
+    write(buf, len);
   }
 
   template <class T>
@@ -210,8 +287,10 @@ struct binary_archive<true> : public binary_archive_base<std::ostream, true>
   template <class T>
   void serialize_uvarint(T &v)
   {
-    typedef std::ostreambuf_iterator<char> it;
-    tools::write_varint(it(stream_), v);
+    uint8_t buf[(sizeof(T) * 8 + 6) / 7];
+    uint8_t *end = buf;
+    tools::write_varint(end, v);
+    write(buf, end - buf);
   }
   void begin_array(size_t s)
   {
@@ -227,6 +306,30 @@ struct binary_archive<true> : public binary_archive_base<std::ostream, true>
   void write_variant_tag(variant_tag_type t) {
     serialize_int(t);
   }
+
+protected:
+  void write(const void *data, size_t len)
+  {
+    if (!good())
+      return;
+    size_ += len;
+    if (string_)
+      string_->append((const char *)data, len);
+    else if (ostream_)
+    {
+      ostream_->write((const char *)data, len);
+      if (!ostream_->good())
+        state_ |= ostream_->rdstate();
+    }
+    else if (sink_)
+      sink_->write(data, len);
+  }
+
+  std::ostream *ostream_;
+  std::string *string_;
+  binary_archive_sink *sink_;
+  size_t size_;
+  std::ios_base::iostate state_;
 };
 
 POP_WARNINGS
@@ -40,8 +40,7 @@ namespace serialization {
   template <class T>
     bool parse_binary(const std::string &blob, T &v)
     {
-      std::istringstream istr(blob);
-      binary_archive<false> iar(istr);
+      binary_archive<false> iar{epee::strspan<std::uint8_t>(blob)};
       return ::serialization::serialize(iar, v);
     }
 
@@ -50,11 +49,10 @@ namespace serialization {
   template<class T>
     bool dump_binary(T& v, std::string& blob)
     {
-      std::stringstream ostr;
-      binary_archive<true> oar(ostr);
+      blob.clear();
+      binary_archive<true> oar(blob);
       bool success = ::serialization::serialize(oar, v);
-      blob = ostr.str();
-      return success && ostr.good();
+      return success && oar.good();
     };
 
 }
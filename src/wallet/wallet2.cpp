@@ -745,7 +745,7 @@ static uint64_t decodeRct(const rct::rctSig & rv, const crypto::key_derivation &
 void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote::transaction& tx, const std::vector<uint64_t> &o_indices, uint64_t height, uint64_t ts, bool miner_tx, bool pool)
 {
   if (!miner_tx && !pool)
-    process_unconfirmed(tx, height);
+    process_unconfirmed(txid, tx, height);
   std::vector<size_t> outs;
   std::unordered_map<cryptonote::subaddress_index, uint64_t> tx_money_got_in_outs;  // per receiving subaddress index
   crypto::public_key tx_pub_key = null_pkey;
@@ -1130,12 +1130,11 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
   }
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::process_unconfirmed(const cryptonote::transaction& tx, uint64_t height)
+void wallet2::process_unconfirmed(const crypto::hash &txid, const cryptonote::transaction& tx, uint64_t height)
 {
   if (m_unconfirmed_txs.empty())
     return;
 
-  crypto::hash txid = get_transaction_hash(tx);
   auto unconf_it = m_unconfirmed_txs.find(txid);
   if(unconf_it != m_unconfirmed_txs.end()) {
     if (store_tx_info()) {
@@ -1204,8 +1203,10 @@ void wallet2::process_new_blockchain_entry(const cryptonote::block& b, const cry
     size_t idx = 0;
     BOOST_FOREACH(auto& txblob, bche.txs)
     {
+      // we ask for pruned txes, and only need the base even if the daemon
+      // ignored that and sent them in full
       cryptonote::transaction tx;
-      bool r = parse_and_validate_tx_from_blob(txblob, tx);
+      bool r = parse_and_validate_tx_base_from_blob(txblob, tx);
       THROW_WALLET_EXCEPTION_IF(!r, error::tx_parse_error, txblob);
       process_new_transaction(b.tx_hashes[idx], tx, o_indices.indices[txidx++].indices, height, b.timestamp, false, false);
       ++idx;
@@ -1265,6 +1266,7 @@ void wallet2::pull_blocks(uint64_t start_height, uint64_t &blocks_start_height,
   req.block_ids = short_chain_history;
 
   req.start_height = start_height;
+  req.prune = true;
   m_daemon_rpc_mutex.lock();
   bool r = net_utils::invoke_http_bin_remote_command2(m_daemon_address + "/getblocks.bin", req, res, m_http_client, WALLET_RCP_CONNECTION_TIMEOUT);
   m_daemon_rpc_mutex.unlock();
@@ -3111,12 +3113,35 @@ void wallet2::get_unconfirmed_payments(std::list<std::pair<crypto::hash, wallet2
 //----------------------------------------------------------------------------------------------------
 void wallet2::rescan_spent()
 {
-  // This is RPC call that can take a long time if there are many outputs,
-  // so we call it several times, in stripes, so we don't time out spuriously
   std::vector<int> spent_status;
   spent_status.reserve(m_transfers.size());
+
+  // binary version first, daemons which do not have it fail the call
+  {
+    COMMAND_RPC_ARE_KEY_IMAGES_SPENT::request req = AUTO_VAL_INIT(req);
+    COMMAND_RPC_ARE_KEY_IMAGES_SPENT::response daemon_resp = AUTO_VAL_INIT(daemon_resp);
+    req.key_images.reserve(m_transfers.size());
+    for (const transfer_details& td: m_transfers)
+      req.key_images.push_back(td.m_key_image);
+    m_daemon_rpc_mutex.lock();
+    bool r = req.key_images.size() <= COMMAND_RPC_ARE_KEY_IMAGES_SPENT_MAX_COUNT &&
+        epee::net_utils::invoke_http_bin_remote_command2(m_daemon_address + "/are_key_images_spent.bin", req, daemon_resp, m_http_client, 200000);
+    m_daemon_rpc_mutex.unlock();
+    THROW_WALLET_EXCEPTION_IF(r && daemon_resp.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "are_key_images_spent.bin");
+    if (r && daemon_resp.status == CORE_RPC_STATUS_OK)
+    {
+      THROW_WALLET_EXCEPTION_IF(daemon_resp.spent_status.size() != (m_transfers.size() + 3) / 4, error::wallet_internal_error,
+        "daemon returned wrong response for are_key_images_spent.bin, wrong size = " +
+        std::to_string(daemon_resp.spent_status.size()) + ", expected " + std::to_string((m_transfers.size() + 3) / 4));
+      for (size_t i = 0; i < m_transfers.size(); ++i)
+        spent_status.push_back(COMMAND_RPC_ARE_KEY_IMAGES_SPENT::get_status(daemon_resp.spent_status, i));
+    }
+  }
+
+  // This is RPC call that can take a long time if there are many outputs,
+  // so we call it several times, in stripes, so we don't time out spuriously
   const size_t chunk_size = 1000;
-  for (size_t start_offset = 0; start_offset < m_transfers.size(); start_offset += chunk_size)
+  for (size_t start_offset = spent_status.size(); start_offset < m_transfers.size(); start_offset += chunk_size)
   {
     const size_t n_outputs = std::min<size_t>(chunk_size, m_transfers.size() - start_offset);
     //MDEBUG("Calling is_key_image_spent on " << start_offset << " - " << (start_offset + n_outputs - 1) << ", out of " << m_transfers.size());